@@ -0,0 +1,35 @@
+#version 450 core
+
+out vec4 fragment_color;
+
+in vec2 texture_coordinate;
+in vec3 vertex_color;
+#ifdef TEXTURE_ARRAY
+flat in float texture_layer;
+#endif
+#ifdef CHAOS
+in vec2 region_coordinate;
+flat in vec4 region_uv;
+#endif
+
+#ifdef TEXTURE_ARRAY
+uniform sampler2DArray u_texture;
+#else
+uniform sampler2D u_texture;
+#endif
+
+void main() {
+#ifdef CHAOS
+    vec2 coordinate = mix(region_uv.xy, region_uv.zw, fract(region_coordinate));
+#else
+    vec2 coordinate = texture_coordinate;
+#endif
+#ifdef TEXTURE_ARRAY
+    fragment_color = vec4(vertex_color, 1.0f) * texture(u_texture, vec3(coordinate, texture_layer));
+#else
+    fragment_color = vec4(vertex_color, 1.0f) * texture(u_texture, coordinate);
+#endif
+#ifdef GRAYSCALE
+    fragment_color.rgb = vec3(dot(fragment_color.rgb, vec3(0.2126f, 0.7152f, 0.0722f)));
+#endif
+}
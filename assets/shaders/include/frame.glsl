@@ -0,0 +1,6 @@
+// Per-frame values, written by renderer_begin
+layout(std140, binding = 0) uniform Frame {
+    mat4 u_projection;
+    vec2 u_screen_size;
+    float u_time;
+};
@@ -0,0 +1,79 @@
+#version 450 core
+
+// Variants: INSTANCED reads instance layer attributes instead of the Sprites buffer,
+// SHAKE wobbles the whole quad and CHAOS scrolls the texture inside the sprite's region.
+// TEXTURE_ARRAY samples a layer of a sampler2DArray, the layer rides in the color's alpha.
+
+#include "include/frame.glsl"
+
+#ifdef INSTANCED
+layout(location = 0) in vec4 vertex;
+layout(location = 1) in vec4 instance_rect;
+layout(location = 2) in vec4 instance_color_rotation;
+layout(location = 3) in vec4 instance_uv;
+layout(location = 4) in float instance_layer;
+#else
+struct Sprite {
+    // Affine rows mapping the unit quad to world space: x = dot(transform[0].xyz, vec3(u, v, 1))
+    vec4 transform[2];
+    vec4 uv;
+    vec4 color;
+};
+
+layout(std430, binding = 0) readonly buffer Sprites {
+    Sprite sprites[];
+};
+
+const vec2 corners[6] = vec2[](
+    vec2(0.0f, 1.0f), vec2(1.0f, 0.0f), vec2(0.0f, 0.0f),
+    vec2(0.0f, 1.0f), vec2(1.0f, 1.0f), vec2(1.0f, 0.0f)
+);
+#endif
+
+out vec2 texture_coordinate;
+out vec3 vertex_color;
+#ifdef TEXTURE_ARRAY
+flat out float texture_layer;
+#endif
+#ifdef CHAOS
+// Wrapped per fragment, a wrap between vertices would collapse the quad to one texel
+out vec2 region_coordinate;
+flat out vec4 region_uv;
+#endif
+
+void main() {
+#ifdef INSTANCED
+    vec2 corner = vertex.zw;
+    vec2 size = instance_rect.zw;
+    float angle = radians(instance_color_rotation.w);
+    mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+
+    vec2 position = instance_rect.xy + 0.5f * size + rotation * ((vertex.xy - 0.5f) * size);
+    vec4 uv = instance_uv;
+    vertex_color = instance_color_rotation.rgb;
+#ifdef TEXTURE_ARRAY
+    texture_layer = instance_layer;
+#endif
+#else
+    Sprite sprite = sprites[gl_InstanceID];
+    vec2 corner = corners[gl_VertexID];
+    vec3 unit = vec3(corner, 1.0f);
+
+    vec2 position = vec2(dot(sprite.transform[0].xyz, unit), dot(sprite.transform[1].xyz, unit));
+    vec4 uv = sprite.uv;
+    vertex_color = sprite.color.rgb;
+#ifdef TEXTURE_ARRAY
+    texture_layer = sprite.color.a;
+#endif
+#endif
+
+    gl_Position = u_projection * vec4(position, 0.0f, 1.0f);
+#ifdef SHAKE
+    gl_Position.xy += 0.01f * vec2(cos(u_time * 10.0f), cos(u_time * 15.0f));
+#endif
+    texture_coordinate = mix(uv.xy, uv.zw, corner);
+#ifdef CHAOS
+    region_coordinate = corner + 0.3f * vec2(sin(u_time), cos(u_time));
+    region_uv = uv;
+#endif
+}
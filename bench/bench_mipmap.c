@@ -0,0 +1,124 @@
+#include "core/clock.h"
+#include "mipmap.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ITERATIONS 3
+
+static float srgb_decode(float value) {
+	return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float srgb_encode(float value) {
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// The straightforward chain: powf per channel both ways and a scalar box filter
+static void reference_box(const uint8_t *pixels, uint32_t width, uint32_t height, MipChain *chain) {
+	float *current = malloc((size_t)width * height * 4 * sizeof(float));
+	for (size_t i = 0; i < (size_t)width * height; i++) {
+		float alpha = pixels[4 * i + 3] / 255.0f;
+		for (uint32_t c = 0; c < 3; c++)
+			current[4 * i + c] = srgb_decode(pixels[4 * i + c] / 255.0f) * alpha;
+		current[4 * i + 3] = alpha;
+	}
+	memcpy(chain->pixels, pixels, (size_t)width * height * 4);
+
+	for (uint32_t level = 1; level < chain->level_count; level++) {
+		uint32_t next_width = mipmap_level_dimension(width, 1), next_height = mipmap_level_dimension(height, 1);
+		float *next = malloc((size_t)next_width * next_height * 4 * sizeof(float));
+		uint8_t *out = chain->pixels + chain->offsets[level];
+		for (uint32_t y = 0; y < next_height; y++) {
+			uint32_t y0 = 2 * y < height ? 2 * y : height - 1, y1 = 2 * y + 1 < height ? 2 * y + 1 : height - 1;
+			for (uint32_t x = 0; x < next_width; x++) {
+				uint32_t x0 = 2 * x < width ? 2 * x : width - 1, x1 = 2 * x + 1 < width ? 2 * x + 1 : width - 1;
+				float *texel = next + ((size_t)y * next_width + x) * 4;
+				for (uint32_t c = 0; c < 4; c++) {
+					texel[c] = 0.25f * (current[((size_t)y0 * width + x0) * 4 + c] + current[((size_t)y0 * width + x1) * 4 + c] +
+						current[((size_t)y1 * width + x0) * 4 + c] + current[((size_t)y1 * width + x1) * 4 + c]);
+				}
+
+				uint8_t *pixel = out + ((size_t)y * next_width + x) * 4;
+				for (uint32_t c = 0; c < 3; c++) {
+					float color = texel[3] > 0.0f ? fminf(texel[c] / texel[3], 1.0f) : 0.0f;
+					pixel[c] = (uint8_t)(srgb_encode(color) * 255.0f + 0.5f);
+				}
+				pixel[3] = (uint8_t)(texel[3] * 255.0f + 0.5f);
+			}
+		}
+		free(current);
+		current = next;
+		width = next_width;
+		height = next_height;
+	}
+	free(current);
+}
+
+// Sprite-like content: smooth gradients, noise and fully transparent gaps between cells
+static uint8_t *make_atlas(uint32_t size) {
+	uint8_t *pixels = malloc((size_t)size * size * 4);
+	srand(1);
+	for (uint32_t y = 0; y < size; y++) {
+		for (uint32_t x = 0; x < size; x++) {
+			uint8_t *pixel = pixels + ((size_t)y * size + x) * 4;
+			pixel[0] = (uint8_t)(x * 255 / size);
+			pixel[1] = (uint8_t)(y * 255 / size);
+			pixel[2] = (uint8_t)(rand() & 0xFF);
+			pixel[3] = (x % 64) < 56 && (y % 64) < 56 ? 255 : 0;
+		}
+	}
+	return pixels;
+}
+
+static double bench_generate(const uint8_t *pixels, uint32_t size, MipmapFilter filter) {
+	uint64_t best = UINT64_MAX;
+	for (uint32_t iteration = 0; iteration < ITERATIONS; iteration++) {
+		MipChain chain;
+		uint64_t start = clock_now_ns();
+		mipmap_generate(pixels, size, size, 4, true, filter, &chain);
+		uint64_t elapsed = clock_now_ns() - start;
+		best = elapsed < best ? elapsed : best;
+		mipmap_release(&chain);
+	}
+	return best / 1e6;
+}
+
+int main(void) {
+	static const uint32_t sizes[] = { 2048, 4096 };
+
+	for (uint32_t i = 0; i < sizeof(sizes) / sizeof(*sizes); i++) {
+		uint32_t size = sizes[i];
+		uint8_t *pixels = make_atlas(size);
+		double texels = (double)size * size;
+
+		MipChain chain, reference;
+		mipmap_generate(pixels, size, size, 4, true, MIPMAP_FILTER_BOX, &chain);
+		reference = chain;
+		reference.pixels = malloc(chain.size);
+
+		uint64_t start = clock_now_ns();
+		reference_box(pixels, size, size, &reference);
+		double reference_ms = (clock_now_ns() - start) / 1e6;
+
+		uint32_t max_difference = 0;
+		for (size_t byte = 0; byte < chain.size; byte++) {
+			uint32_t difference = (uint32_t)abs(chain.pixels[byte] - reference.pixels[byte]);
+			max_difference = difference > max_difference ? difference : max_difference;
+		}
+		mipmap_release(&chain);
+		free(reference.pixels);
+
+		double box_ms = bench_generate(pixels, size, MIPMAP_FILTER_BOX);
+		double kaiser_ms = bench_generate(pixels, size, MIPMAP_FILTER_KAISER);
+		printf("%ux%u atlas, %u levels\n", size, size, mipmap_level_count(size, size));
+		printf("  reference box %8.2f ms/chain %7.1f MTexels/s\n", reference_ms, texels / reference_ms / 1e3);
+		printf("  box           %8.2f ms/chain %7.1f MTexels/s (%.1fx), max difference %u\n", box_ms, texels / box_ms / 1e3, reference_ms / box_ms, max_difference);
+		printf("  kaiser        %8.2f ms/chain %7.1f MTexels/s\n", kaiser_ms, texels / kaiser_ms / 1e3);
+		free(pixels);
+	}
+
+	return 0;
+}
@@ -0,0 +1,81 @@
+#include "core/clock.h"
+#include "transform.h"
+
+#include <cglm/cglm.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SPRITE_COUNT 4096
+#define ITERATIONS 1000
+
+static float x[SPRITE_COUNT], y[SPRITE_COUNT], width[SPRITE_COUNT], height[SPRITE_COUNT], rotation[SPRITE_COUNT];
+static float corners[SPRITE_COUNT * 8];
+static mat4 models[SPRITE_COUNT];
+
+// The per-sprite model matrix renderer_draw_sprite used to build
+static void cglm_model(float px, float py, float w, float h, float rotate, mat4 model) {
+	glm_mat4_identity(model);
+	glm_translate(model, (vec3){ px, py, 0.0f });
+	glm_translate(model, (vec3){ 0.5f * w, 0.5f * h, 0.0f });
+	glm_rotate(model, glm_rad(rotate), (vec3){ 0.0f, 0.0f, 1.0f });
+	glm_translate(model, (vec3){ -0.5f * w, -0.5f * h, 0.0f });
+	glm_scale(model, (vec3){ w, h, 1.0f });
+}
+
+static double bench_cglm(void) {
+	uint64_t start = clock_now_ns();
+	for (uint32_t iteration = 0; iteration < ITERATIONS; iteration++)
+		for (uint32_t i = 0; i < SPRITE_COUNT; i++)
+			cglm_model(x[i], y[i], width[i], height[i], rotation[i], models[i]);
+	return (double)(clock_now_ns() - start) / ((double)ITERATIONS * SPRITE_COUNT);
+}
+
+static double bench_corners(void) {
+	uint64_t start = clock_now_ns();
+	for (uint32_t iteration = 0; iteration < ITERATIONS; iteration++)
+		transform_batch_corners(x, y, width, height, rotation, SPRITE_COUNT, corners);
+	return (double)(clock_now_ns() - start) / ((double)ITERATIONS * SPRITE_COUNT);
+}
+
+static float max_error(void) {
+	static const float unit[4][2] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+
+	float error = 0.0f;
+	for (uint32_t i = 0; i < SPRITE_COUNT; i++) {
+		for (uint32_t corner = 0; corner < 4; corner++) {
+			vec4 p;
+			glm_mat4_mulv(models[i], (vec4){ unit[corner][0], unit[corner][1], 0.0f, 1.0f }, p);
+			error = fmaxf(error, fabsf(p[0] - corners[i * 8 + corner * 2 + 0]));
+			error = fmaxf(error, fabsf(p[1] - corners[i * 8 + corner * 2 + 1]));
+		}
+	}
+	return error;
+}
+
+static void fill(float rotated_fraction) {
+	srand(1);
+	for (uint32_t i = 0; i < SPRITE_COUNT; i++) {
+		x[i] = (float)(rand() % 1280);
+		y[i] = (float)(rand() % 720);
+		width[i] = (float)(8 + rand() % 120);
+		height[i] = (float)(8 + rand() % 120);
+		rotation[i] = (float)rand() / RAND_MAX < rotated_fraction ? (float)(rand() % 360) : 0.0f;
+	}
+}
+
+int main(void) {
+	static const float fractions[] = { 0.0f, 0.1f, 1.0f };
+
+	printf("%u sprites, %u iterations\n", SPRITE_COUNT, ITERATIONS);
+	for (uint32_t i = 0; i < sizeof(fractions) / sizeof(*fractions); i++) {
+		fill(fractions[i]);
+		double cglm = bench_cglm();
+		double batch = bench_corners();
+		printf("rotated %3.0f%%: cglm %6.2f ns/sprite, batch %6.2f ns/sprite (%.1fx), max error %g\n",
+			fractions[i] * 100.0f, cglm, batch, cglm / batch, max_error());
+	}
+
+	return 0;
+}
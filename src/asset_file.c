@@ -0,0 +1,124 @@
+#include "asset_file.h"
+
+#include "core/file.h"
+#include "core/logger.h"
+#include "pak.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <stb/stb_image.h>
+
+typedef struct {
+	Pak pak;
+	bool mounted;
+} AssetFiles;
+
+static AssetFiles g_asset_files = { 0 };
+
+bool asset_file_mount(const char *path) {
+	asset_file_unmount();
+	if (!pak_open(path, &g_asset_files.pak))
+		return false;
+
+	g_asset_files.mounted = true;
+	LOG_INFO("PAK: Mounted %s, %u entries (%.1f MB)", path, g_asset_files.pak.entry_count, g_asset_files.pak.mapping.size / 1048576.0);
+	return true;
+}
+
+void asset_file_unmount(void) {
+	if (g_asset_files.mounted)
+		pak_close(&g_asset_files.pak);
+	g_asset_files = (AssetFiles){ 0 };
+}
+
+bool asset_file_mounted(void) {
+	return g_asset_files.mounted;
+}
+
+static const PakEntry *asset_file_find(const char *path, PakEntryType type) {
+	if (!g_asset_files.mounted)
+		return NULL;
+	const PakEntry *entry = pak_find(&g_asset_files.pak, path);
+	return entry && entry->type == type ? entry : NULL;
+}
+
+bool asset_file_archived(const char *path) {
+	return g_asset_files.mounted && pak_find(&g_asset_files.pak, path) != NULL;
+}
+
+bool asset_file_read(const char *path, AssetFile *file) {
+	const PakEntry *entry = asset_file_find(path, PAK_ENTRY_FILE);
+	if (entry) {
+		*file = (AssetFile){
+			.data = (const char *)pak_entry_data(&g_asset_files.pak, entry),
+			.size = entry->size,
+		};
+		return true;
+	}
+
+	char *text = file_read_text(path);
+	*file = (AssetFile){
+		.data = text,
+		.size = text ? strlen(text) : 0,
+		.owned = text,
+	};
+	return text != NULL;
+}
+
+void asset_file_release(AssetFile *file) {
+	free(file->owned);
+	*file = (AssetFile){ 0 };
+}
+
+bool asset_file_load_image(const char *path, AssetImage *image) {
+	const PakEntry *entry = asset_file_find(path, PAK_ENTRY_IMAGE);
+	if (entry) {
+		*image = (AssetImage){
+			.pixels = pak_entry_data(&g_asset_files.pak, entry),
+			.width = entry->width,
+			.height = entry->height,
+			.channels = entry->channels,
+		};
+		return true;
+	}
+
+	*image = (AssetImage){ 0 };
+	image->owned = stbi_load(path, &image->width, &image->height, &image->channels, 0);
+	image->pixels = image->owned;
+	return image->owned != NULL;
+}
+
+void asset_file_release_image(AssetImage *image) {
+	if (image->owned)
+		stbi_image_free(image->owned);
+	*image = (AssetImage){ 0 };
+}
+
+bool asset_file_load_level(const char *path, LevelTiles *level) {
+	const PakEntry *entry = asset_file_find(path, PAK_ENTRY_LEVEL);
+	if (entry) {
+		*level = (LevelTiles){
+			.columns = entry->width,
+			.rows = entry->height,
+			.tiles = pak_entry_data(&g_asset_files.pak, entry),
+		};
+		return true;
+	}
+
+	AssetFile file;
+	if (!asset_file_read(path, &file)) {
+		*level = (LevelTiles){ 0 };
+		return false;
+	}
+	bool success = level_file_parse_csv(path, file.data, file.size, level);
+	asset_file_release(&file);
+	return success;
+}
+
+bool asset_file_read_ktx2(const char *path, Ktx2Image *image) {
+	const PakEntry *entry = asset_file_find(path, PAK_ENTRY_FILE);
+	if (entry)
+		return ktx2_parse(path, pak_entry_data(&g_asset_files.pak, entry), entry->size, image);
+	return ktx2_read(path, image);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "ktx2.h"
+#include "level_file.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Every asset read goes through here. Paths are looked up in the mounted archive first and read
+// from loose files when the archive is not mounted or lacks them, which is how assets are edited
+// during development. Archive reads point straight into the mapping and allocate nothing.
+// Mounting is not thread safe, reads are.
+bool asset_file_mount(const char *path);
+void asset_file_unmount(void);
+bool asset_file_mounted(void);
+// True when path is read from the archive, which never changes while mapped
+bool asset_file_archived(const char *path);
+
+// Null terminated contents
+typedef struct {
+	const char *data;
+	size_t size;
+	// Loose file contents to free, NULL for archive reads
+	char *owned;
+} AssetFile;
+
+bool asset_file_read(const char *path, AssetFile *file);
+void asset_file_release(AssetFile *file);
+
+// 8 bit texels with the channel count of the source image, decoded with stb_image for loose files
+typedef struct {
+	const uint8_t *pixels;
+	int32_t width, height, channels;
+	uint8_t *owned;
+} AssetImage;
+
+bool asset_file_load_image(const char *path, AssetImage *image);
+void asset_file_release_image(AssetImage *image);
+
+// Cooked levels point into the archive, loose .csv files are parsed
+bool asset_file_load_level(const char *path, LevelTiles *level);
+
+// Like ktx2_read, archived images point into the mapping and own nothing. Returns false without
+// logging when the texture is neither archived nor on disk.
+bool asset_file_read_ktx2(const char *path, Ktx2Image *image);
@@ -0,0 +1,166 @@
+#include "asset_graph.h"
+
+#include "core/arena.h"
+#include "core/handle_pool.h"
+#include "core/logger.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define ASSET_GRAPH_INDEX(node) ((node) & (HANDLE_POOL_MAX_CAPACITY - 1))
+
+typedef struct {
+	AssetNodeKind kind;
+	uint32_t asset;
+	bool dirty, building;
+} AssetNode;
+
+typedef struct {
+	uint32_t dependent, dependency;
+} AssetEdge;
+
+struct _asset_graph {
+	HandlePool *nodes;
+	AssetEdge *edges;
+	uint32_t edge_count, edge_capacity;
+
+	// Scratch for walks over the graph, one slot per node
+	uint32_t *stack;
+	bool *blocked;
+};
+
+AssetGraph *asset_graph_create(Arena *arena, uint32_t node_capacity, uint32_t edge_capacity) {
+	AssetGraph *graph = arena_push_type(arena, AssetGraph);
+	*graph = (AssetGraph){
+		.nodes = handle_pool_create(arena, node_capacity, sizeof(AssetNode)),
+		.edges = arena_push_array(arena, AssetEdge, edge_capacity),
+		.edge_capacity = edge_capacity,
+		.stack = arena_push_array(arena, uint32_t, node_capacity),
+		.blocked = arena_push_array(arena, bool, node_capacity),
+	};
+	return graph;
+}
+
+uint32_t asset_graph_add(AssetGraph *graph, AssetNodeKind kind, uint32_t asset) {
+	uint32_t node = handle_pool_alloc(graph->nodes);
+	if (node == HANDLE_INVALID) {
+		LOG_WARN("ASSETS: Dependency graph full, changes to asset %u are not tracked", asset);
+		return HANDLE_INVALID;
+	}
+
+	AssetNode *item = handle_pool_get(graph->nodes, node);
+	item->kind = kind;
+	item->asset = asset;
+	return node;
+}
+
+void asset_graph_remove(AssetGraph *graph, uint32_t node) {
+	if (handle_pool_get(graph->nodes, node) == NULL)
+		return;
+
+	for (uint32_t i = 0; i < graph->edge_count;) {
+		if (graph->edges[i].dependent == node || graph->edges[i].dependency == node)
+			graph->edges[i] = graph->edges[--graph->edge_count];
+		else
+			i++;
+	}
+	handle_pool_free(graph->nodes, node);
+}
+
+AssetNodeKind asset_graph_kind(const AssetGraph *graph, uint32_t node) {
+	AssetNode *item = handle_pool_get(graph->nodes, node);
+	return item ? item->kind : ASSET_NODE_FILE;
+}
+
+uint32_t asset_graph_asset(const AssetGraph *graph, uint32_t node) {
+	AssetNode *item = handle_pool_get(graph->nodes, node);
+	return item ? item->asset : HANDLE_INVALID;
+}
+
+bool asset_graph_depend(AssetGraph *graph, uint32_t dependent, uint32_t dependency) {
+	if (dependent == dependency || handle_pool_get(graph->nodes, dependent) == NULL || handle_pool_get(graph->nodes, dependency) == NULL)
+		return false;
+
+	for (uint32_t i = 0; i < graph->edge_count; i++) {
+		if (graph->edges[i].dependent == dependent && graph->edges[i].dependency == dependency)
+			return true;
+	}
+
+	if (graph->edge_count == graph->edge_capacity) {
+		LOG_WARN("ASSETS: Dependency graph full, asset %u does not follow asset %u", asset_graph_asset(graph, dependent), asset_graph_asset(graph, dependency));
+		return false;
+	}
+	graph->edges[graph->edge_count++] = (AssetEdge){ dependent, dependency };
+	return true;
+}
+
+void asset_graph_clear_dependencies(AssetGraph *graph, uint32_t node) {
+	for (uint32_t i = 0; i < graph->edge_count;) {
+		if (graph->edges[i].dependent == node)
+			graph->edges[i] = graph->edges[--graph->edge_count];
+		else
+			i++;
+	}
+}
+
+void asset_graph_invalidate(AssetGraph *graph, uint32_t node) {
+	AssetNode *item = handle_pool_get(graph->nodes, node);
+	if (item == NULL || item->dirty)
+		return;
+
+	// A node is pushed when it turns dirty, so each is visited once
+	item->dirty = true;
+	uint32_t count = 0;
+	graph->stack[count++] = node;
+	while (count > 0) {
+		uint32_t dependency = graph->stack[--count];
+		for (uint32_t i = 0; i < graph->edge_count; i++) {
+			if (graph->edges[i].dependency != dependency)
+				continue;
+
+			AssetNode *dependent = handle_pool_get(graph->nodes, graph->edges[i].dependent);
+			if (dependent->dirty)
+				continue;
+			dependent->dirty = true;
+			graph->stack[count++] = graph->edges[i].dependent;
+		}
+	}
+}
+
+uint32_t asset_graph_take_ready(AssetGraph *graph, uint32_t *nodes, uint32_t max) {
+	uint32_t end = handle_pool_end(graph->nodes);
+	memset(graph->blocked, 0, end * sizeof(bool));
+	for (uint32_t i = 0; i < graph->edge_count; i++) {
+		AssetNode *dependency = handle_pool_get(graph->nodes, graph->edges[i].dependency);
+		if (dependency->dirty || dependency->building)
+			graph->blocked[ASSET_GRAPH_INDEX(graph->edges[i].dependent)] = true;
+	}
+
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < end && count < max; i++) {
+		uint32_t node = handle_pool_handle_at(graph->nodes, i);
+		AssetNode *item = handle_pool_get(graph->nodes, node);
+		if (item == NULL || !item->dirty || item->building || graph->blocked[i])
+			continue;
+
+		item->dirty = false;
+		item->building = true;
+		nodes[count++] = node;
+	}
+	return count;
+}
+
+void asset_graph_rebuilt(AssetGraph *graph, uint32_t node) {
+	AssetNode *item = handle_pool_get(graph->nodes, node);
+	if (item)
+		item->building = false;
+}
+
+uint32_t asset_graph_pending(const AssetGraph *graph) {
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < handle_pool_end(graph->nodes); i++) {
+		AssetNode *item = handle_pool_get(graph->nodes, handle_pool_handle_at(graph->nodes, i));
+		count += item && (item->dirty || item->building);
+	}
+	return count;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct _arena Arena;
+typedef struct _asset_graph AssetGraph;
+
+typedef enum {
+	// A source file on disk, rebuilt by nothing
+	ASSET_NODE_FILE,
+	ASSET_NODE_TEXTURE,
+	ASSET_NODE_SHADER,
+	ASSET_NODE_LEVEL,
+} AssetNodeKind;
+
+// Records which assets are built from which. Nodes are handle_pool handles, so a node removed
+// while its rebuild is in flight is simply not found when the rebuild reports back.
+// Invalidating a node invalidates everything depending on it, directly or not. Rebuilds are handed
+// out in topological order: a dirty node is ready once nothing it depends on is dirty or building.
+AssetGraph *asset_graph_create(Arena *arena, uint32_t node_capacity, uint32_t edge_capacity);
+
+// asset is the handle of whatever the node stands for, HANDLE_INVALID when the graph is full
+uint32_t asset_graph_add(AssetGraph *graph, AssetNodeKind kind, uint32_t asset);
+// Drops the node and every edge touching it
+void asset_graph_remove(AssetGraph *graph, uint32_t node);
+AssetNodeKind asset_graph_kind(const AssetGraph *graph, uint32_t node);
+uint32_t asset_graph_asset(const AssetGraph *graph, uint32_t node);
+
+// dependent is rebuilt whenever dependency changes. Adding an edge twice keeps one. Nodes on a
+// cycle would never be ready, so edges only ever point from an asset to what it is built from.
+bool asset_graph_depend(AssetGraph *graph, uint32_t dependent, uint32_t dependency);
+// Drops the edges to everything node depends on, so a rebuild can record them again
+void asset_graph_clear_dependencies(AssetGraph *graph, uint32_t node);
+
+void asset_graph_invalidate(AssetGraph *graph, uint32_t node);
+// Takes up to max ready nodes and marks them building. Invalidating a building node makes it
+// dirty again, it is handed out once more after asset_graph_rebuilt.
+uint32_t asset_graph_take_ready(AssetGraph *graph, uint32_t *nodes, uint32_t max);
+void asset_graph_rebuilt(AssetGraph *graph, uint32_t node);
+// Dirty and building nodes
+uint32_t asset_graph_pending(const AssetGraph *graph);
@@ -1,92 +1,1011 @@
 #include "asset_manager.h"
 
+#include "asset_file.h"
+#include "asset_graph.h"
+#include "atlas.h"
 #include "core/arena.h"
+#include "core/clock.h"
+#include "core/file.h"
+#include "core/file_watcher.h"
+#include "core/handle_pool.h"
 #include "core/hash_table.h"
 #include "core/logger.h"
+#include "core/thread_pool.h"
 
+#include "ktx2.h"
+#include "mipmap.h"
+#include "release_queue.h"
+#include "ring_buffer.h"
 #include "shader.h"
+#include "shader_preprocessor.h"
 #include "texture.h"
+#include "texture_residency.h"
 
 #include <errno.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-#include <stb/stb_image.h>
+#define ATLAS_PAGE_SIZE 2048
+#define ASSET_MANAGER_ARCHIVE "assets.pak"
+
+#define ASSET_MANAGER_MAX_SHADERS 32
+#define ASSET_MANAGER_MAX_TEXTURES 256
+#define ASSET_MANAGER_MAX_LEVELS 16
+#define ASSET_MANAGER_MAX_LEVEL_TEXTURES 8
+#define ASSET_MANAGER_MAX_TEXTURE_LOADS 256
+#define ASSET_MANAGER_MAX_REBUILDS 64
+#define ASSET_PATH_LENGTH 256
+#define ASSET_GRAPH_MAX_NODES (FILE_WATCHER_MAX_FILES + ASSET_MANAGER_MAX_SHADERS + ASSET_MANAGER_MAX_TEXTURES + ASSET_MANAGER_MAX_LEVELS)
+#define ASSET_GRAPH_MAX_EDGES 1024
+
+// Bytes of texels uploaded per frame, a single larger texture still goes through on its own
+#define TEXTURE_UPLOAD_BUDGET (4 * 1024 * 1024)
+#define TEXTURE_UPLOAD_REGIONS 3
+
+// A vertex/fragment pair and the variants compiled from it, indexed by feature mask
+typedef struct {
+	const char *name;
+	const char *vertex_path, *fragment_path;
+	const char **features;
+	uint32_t feature_count;
+
+	PreprocessedShader vertex, fragment;
+	OpenGLShader **variants;
+
+	// Depends on every file either stage was assembled from
+	uint32_t node;
+	uint32_t references;
+} ShaderFamily;
+
+typedef enum {
+	// The placeholder region while decoding, and after a failed load
+	TEXTURE_ASSET_PLACEHOLDER,
+	TEXTURE_ASSET_PACKED,
+	// A texture of its own, released through the release queue
+	TEXTURE_ASSET_OWNED,
+} TextureAssetStorage;
+
+typedef struct {
+	char name[HT_MAX_KEY_SIZE];
+	char path[ASSET_PATH_LENGTH];
+	MipmapFilter filter;
+	TextureRegion region;
+	TextureAssetStorage storage;
+	uint32_t node;
+	uint32_t references;
+} TextureAsset;
+
+// Tiles and the textures they are drawn with, which the level holds a reference to
+typedef struct {
+	char name[HT_MAX_KEY_SIZE];
+	char path[ASSET_PATH_LENGTH];
+	LevelTiles tiles;
+	TextureHandle textures[ASSET_MANAGER_MAX_LEVEL_TEXTURES];
+	uint32_t texture_count;
+	uint32_t version;
+	uint32_t node;
+	uint32_t references;
+} LevelAsset;
+
+typedef enum {
+	TEXTURE_LOAD_DECODING,
+	TEXTURE_LOAD_DECODED,
+	TEXTURE_LOAD_FAILED,
+} TextureLoadState;
+
+// An image decoded on the thread pool, the texture's region is overwritten in place once the
+// texels are uploaded
+typedef struct {
+	char path[ASSET_PATH_LENGTH];
+	TextureHandle texture;
+	// TextureLoadState, published by the worker with release ordering
+	uint32_t state;
+
+	int32_t width, height, channels;
+	// Padded RGBA ready for the atlas
+	uint8_t *pixels;
+	bool padded;
+	// The image as decoded when it does not fit a page
+	AssetImage image;
+	// Set instead of pixels when the image gets a mip chain
+	MipmapFilter filter;
+	MipChain mips;
+	// Set instead of pixels when a cooked texture was read
+	Ktx2Image cooked;
+	bool is_cooked;
+	// Graph node of a texture being rebuilt, which is done once the load finishes
+	uint32_t node;
+} TextureLoad;
+
+typedef enum {
+	ASSET_REBUILD_RUNNING,
+	ASSET_REBUILD_DONE,
+	ASSET_REBUILD_FAILED,
+} AssetRebuildState;
+
+// The part of a shader or level rebuild that reads files, run on the thread pool. The main thread
+// swaps the results in once state is published.
+typedef struct {
+	uint32_t node;
+	AssetNodeKind kind;
+	// AssetRebuildState, published by the worker with release ordering
+	uint32_t state;
+
+	const char *vertex_path, *fragment_path;
+	PreprocessedShader vertex, fragment;
+
+	char path[ASSET_PATH_LENGTH];
+	LevelTiles tiles;
+} AssetRebuild;
 
 typedef struct {
 	Arena *asset_arena;
-	HashTable *textures, *shaders;
+	// Names to handles, only searched while loading
+	HashTable *texture_names, *shader_names, *level_names;
+	// TextureAsset, ShaderFamily and LevelAsset
+	HandlePool *textures, *shaders, *levels;
+	TextureAtlas *atlas;
+
+	FileWatcher *watcher;
+	bool watcher_started;
+	uint32_t watcher_generation;
+	// Graph node of each watched file, by watcher id
+	uint32_t file_nodes[FILE_WATCHER_MAX_FILES];
+
+	AssetGraph *graph;
+	// Set when nodes were invalidated or rebuilt, so the graph is only walked after a change
+	bool graph_changed;
+	AssetRebuild *rebuilds[ASSET_MANAGER_MAX_REBUILDS];
+	uint32_t rebuild_count;
+	uint64_t rebuild_start;
+	uint32_t rebuilt_count;
+
+	ThreadPool *decoders;
+	// Pixel unpack buffer the decoded texels are staged in, NULL for headless textures
+	OpenGLRingBuffer *uploads;
+	TextureRegion *placeholder;
+	TextureLoad *texture_loads[ASSET_MANAGER_MAX_TEXTURE_LOADS];
+	uint32_t texture_load_count;
 } AssetManager;
 
 static AssetManager g_asset_manager = { 0 };
+static const char *g_asset_archive = ASSET_MANAGER_ARCHIVE;
+
+void asset_manager_set_archive(const char *path) {
+	g_asset_archive = path;
+}
 
 void asset_manager_startup() {
+	if (g_asset_archive && !asset_file_mount(g_asset_archive))
+		LOG_INFO("No asset archive at %s, loading loose files", g_asset_archive);
+
 	g_asset_manager.asset_arena = arena_alloc();
-	g_asset_manager.shaders = ht_create(g_asset_manager.asset_arena, sizeof(size_t));
-	g_asset_manager.textures = ht_create(g_asset_manager.asset_arena, sizeof(size_t));
+	g_asset_manager.shader_names = ht_create(g_asset_manager.asset_arena, sizeof(uint32_t));
+	g_asset_manager.texture_names = ht_create(g_asset_manager.asset_arena, sizeof(uint32_t));
+	g_asset_manager.level_names = ht_create(g_asset_manager.asset_arena, sizeof(uint32_t));
+	g_asset_manager.shaders = handle_pool_create(g_asset_manager.asset_arena, ASSET_MANAGER_MAX_SHADERS, sizeof(ShaderFamily));
+	g_asset_manager.textures = handle_pool_create(g_asset_manager.asset_arena, ASSET_MANAGER_MAX_TEXTURES, sizeof(TextureAsset));
+	g_asset_manager.levels = handle_pool_create(g_asset_manager.asset_arena, ASSET_MANAGER_MAX_LEVELS, sizeof(LevelAsset));
+	g_asset_manager.graph = asset_graph_create(g_asset_manager.asset_arena, ASSET_GRAPH_MAX_NODES, ASSET_GRAPH_MAX_EDGES);
+	texture_residency_startup(TEXTURE_RESIDENCY_DEFAULT_BUDGET);
+	g_asset_manager.atlas = texture_atlas_create(g_asset_manager.asset_arena, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE);
+	g_asset_manager.decoders = thread_pool_create(g_asset_manager.asset_arena, 0);
 }
+static void texture_asset_destroy(uint32_t handle, TextureAsset *asset);
+static void shader_family_destroy(uint32_t handle, ShaderFamily *family);
+static void level_asset_destroy(uint32_t handle, LevelAsset *level);
+static void asset_rebuild_free(AssetRebuild *rebuild);
+
 void asset_manager_shutdown() {
+	file_watcher_destroy(g_asset_manager.watcher);
+
+	thread_pool_destroy(g_asset_manager.decoders);
+	for (uint32_t i = 0; i < g_asset_manager.texture_load_count; i++) {
+		free(g_asset_manager.texture_loads[i]->pixels);
+		asset_file_release_image(&g_asset_manager.texture_loads[i]->image);
+		mipmap_release(&g_asset_manager.texture_loads[i]->mips);
+		ktx2_release(&g_asset_manager.texture_loads[i]->cooked);
+		free(g_asset_manager.texture_loads[i]);
+	}
+	g_asset_manager.texture_load_count = 0;
+	for (uint32_t i = 0; i < g_asset_manager.rebuild_count; i++)
+		asset_rebuild_free(g_asset_manager.rebuilds[i]);
+	g_asset_manager.rebuild_count = 0;
+
+	// Whatever is still referenced goes as well, levels first as they hold textures
+	for (uint32_t i = 0; i < handle_pool_end(g_asset_manager.levels); i++) {
+		uint32_t handle = handle_pool_handle_at(g_asset_manager.levels, i);
+		if (handle != HANDLE_INVALID)
+			level_asset_destroy(handle, handle_pool_get(g_asset_manager.levels, handle));
+	}
+	for (uint32_t i = 0; i < handle_pool_end(g_asset_manager.textures); i++) {
+		uint32_t handle = handle_pool_handle_at(g_asset_manager.textures, i);
+		if (handle != HANDLE_INVALID)
+			texture_asset_destroy(handle, handle_pool_get(g_asset_manager.textures, handle));
+	}
+	for (uint32_t i = 0; i < handle_pool_end(g_asset_manager.shaders); i++) {
+		uint32_t handle = handle_pool_handle_at(g_asset_manager.shaders, i);
+		if (handle != HANDLE_INVALID)
+			shader_family_destroy(handle, handle_pool_get(g_asset_manager.shaders, handle));
+	}
+	release_queue_flush();
+	texture_atlas_destroy(g_asset_manager.atlas);
+	if (g_asset_manager.uploads)
+		opengl_ring_buffer_destroy(g_asset_manager.uploads);
+	// Cooked images kept for reloads can point into the archive
+	texture_residency_shutdown();
+	asset_file_unmount();
+
 	arena_free(g_asset_manager.asset_arena);
+	g_asset_manager = (AssetManager){ 0 };
 }
 
-OpenGLShader *asset_manager_load_shader(const char *name, const char *vertex_shader_path, const char *fragment_shader_path) {
-	FILE *file = fopen(vertex_shader_path, "r");
+static char *copy_string(Arena *arena, const char *string) {
+	size_t length = strlen(string) + 1;
+	char *copy = arena_push_array(arena, char, length);
+	memcpy(copy, string, length);
+	return copy;
+}
+
+static uint32_t find_handle(HashTable *names, const char *name) {
+	uint32_t *handle = ht_search(names, name);
+	return handle ? *handle : HANDLE_INVALID;
+}
+
+// NULL for slots without a live family
+static ShaderFamily *shader_family_at(uint32_t index) {
+	return handle_pool_get(g_asset_manager.shaders, handle_pool_handle_at(g_asset_manager.shaders, index));
+}
+
+// The graph node of a watched file, HANDLE_INVALID for archived files which never change
+static uint32_t asset_manager_watch(const char *path) {
+	if (asset_file_archived(path))
+		return HANDLE_INVALID;
+
+	if (!g_asset_manager.watcher_started) {
+		g_asset_manager.watcher = file_watcher_create(g_asset_manager.asset_arena);
+		g_asset_manager.watcher_started = true;
+	}
+	uint32_t id = file_watcher_add(g_asset_manager.watcher, path);
+	if (id == FILE_WATCHER_INVALID)
+		return HANDLE_INVALID;
+
+	if (g_asset_manager.file_nodes[id] == HANDLE_INVALID)
+		g_asset_manager.file_nodes[id] = asset_graph_add(g_asset_manager.graph, ASSET_NODE_FILE, id);
+	return g_asset_manager.file_nodes[id];
+}
+
+static void asset_manager_depend_on_file(uint32_t node, const char *path) {
+	uint32_t file = asset_manager_watch(path);
+	if (file != HANDLE_INVALID)
+		asset_graph_depend(g_asset_manager.graph, node, file);
+}
+
+static void shader_family_watch(ShaderFamily *family) {
+	const PreprocessedShader *stages[] = { &family->vertex, &family->fragment };
+
+	// Includes may have changed since the last build
+	asset_graph_clear_dependencies(g_asset_manager.graph, family->node);
+	for (uint32_t stage = 0; stage < 2; stage++) {
+		for (uint32_t i = 0; i < stages[stage]->file_count; i++)
+			asset_manager_depend_on_file(family->node, stages[stage]->files[i]);
+	}
+}
+
+static bool shader_family_preprocess(ShaderFamily *family) {
+	PreprocessedShader vertex, fragment;
+	bool vertex_success = shader_preprocess(family->vertex_path, &vertex);
+	bool fragment_success = shader_preprocess(family->fragment_path, &fragment);
+	if (!vertex_success || !fragment_success) {
+		shader_preprocess_release(&vertex);
+		shader_preprocess_release(&fragment);
+		return false;
+	}
+
+	shader_preprocess_release(&family->vertex);
+	shader_preprocess_release(&family->fragment);
+	family->vertex = vertex;
+	family->fragment = fragment;
+	return true;
+}
 
-	if (fseek(file, 0, SEEK_END) == -1)
-		LOG_ERROR("FILE: %s", strerror(errno));
-	uint32_t offset = ftell(file);
-	rewind(file);
+ShaderHandle asset_manager_load_shader_family(const char *name, const char *vertex_shader_path, const char *fragment_shader_path, const char *const *features, uint32_t feature_count) {
+	ShaderHandle loaded = asset_manager_find_shader(name);
+	if (loaded.id != HANDLE_INVALID)
+		return asset_manager_acquire_shader(loaded);
 
-	char *vertex_shader_source = malloc(offset + 1);
+	uint32_t handle = feature_count <= ASSET_MANAGER_MAX_SHADER_FEATURES ? handle_pool_alloc(g_asset_manager.shaders) : HANDLE_INVALID;
+	if (handle == HANDLE_INVALID) {
+		LOG_ERROR("Shader [ %s ] exceeds the shader limits", name);
+		exit(1);
+	}
 
-	fread(vertex_shader_source, 1, offset, file);
-	fclose(file);
+	Arena *arena = g_asset_manager.asset_arena;
+	ShaderFamily *family = handle_pool_get(g_asset_manager.shaders, handle);
+	family->references = 1;
+	family->name = copy_string(arena, name);
+	family->vertex_path = copy_string(arena, vertex_shader_path);
+	family->fragment_path = copy_string(arena, fragment_shader_path);
+	family->features = arena_push_array(arena, const char *, feature_count);
+	family->feature_count = feature_count;
+	for (uint32_t i = 0; i < feature_count; i++)
+		family->features[i] = copy_string(arena, features[i]);
+	family->variants = arena_push_array_zero(arena, OpenGLShader *, 1u << feature_count);
 
-	vertex_shader_source[offset] = '\0';
+	if (!shader_family_preprocess(family)) {
+		LOG_ERROR("Shader [ %s ] sources not found", name);
+		exit(1);
+	}
 
-	file = fopen(fragment_shader_path, "r");
+	family->node = asset_graph_add(g_asset_manager.graph, ASSET_NODE_SHADER, handle);
+	shader_family_watch(family);
 
-	if (fseek(file, 0, SEEK_END) == -1)
-		LOG_ERROR("FILE: %s", strerror(errno));
-	offset = ftell(file);
-	rewind(file);
+	ht_insert(g_asset_manager.shader_names, name, &handle);
+	return (ShaderHandle){ handle };
+}
 
-	char *fragment_shader_source = malloc(offset + 1);
+OpenGLShader *asset_manager_shader_variant(ShaderHandle shader, uint32_t feature_mask) {
+	ShaderFamily *family = handle_pool_get(g_asset_manager.shaders, shader.id);
+	if (family == NULL)
+		return NULL;
 
-	fread(fragment_shader_source, 1, offset, file);
-	fclose(file);
+	feature_mask &= (1u << family->feature_count) - 1;
 
-	fragment_shader_source[offset] = '\0';
+	OpenGLShader *variant = family->variants[feature_mask];
+	if (variant)
+		return variant;
 
-	OpenGLShader *new_shader = opengl_shader_create(g_asset_manager.asset_arena, vertex_shader_source, fragment_shader_source);
-	
+	char *vertex_shader_source = shader_preprocess_variant(&family->vertex, family->features, family->feature_count, feature_mask);
+	char *fragment_shader_source = shader_preprocess_variant(&family->fragment, family->features, family->feature_count, feature_mask);
+	if (vertex_shader_source == NULL || fragment_shader_source == NULL) {
+		LOG_ERROR("Shader [ %s ] variant 0x%x out of memory", family->name, feature_mask);
+		exit(1);
+	}
+	variant = opengl_shader_submit(g_asset_manager.asset_arena, vertex_shader_source, fragment_shader_source);
 	free(vertex_shader_source);
 	free(fragment_shader_source);
-	
-	ht_insert(g_asset_manager.shaders, name, &new_shader);
-	return new_shader;
+
+	family->variants[feature_mask] = variant;
+	return variant;
+}
+
+ShaderHandle asset_manager_load_shader(const char *name, const char *vertex_shader_path, const char *fragment_shader_path) {
+	ShaderHandle shader = asset_manager_load_shader_family(name, vertex_shader_path, fragment_shader_path, NULL, 0);
+	asset_manager_shader_variant(shader, 0);
+	return shader;
+}
+
+static void shader_family_log_files(const ShaderFamily *family) {
+	const PreprocessedShader *stages[] = { &family->vertex, &family->fragment };
+	for (uint32_t stage = 0; stage < 2; stage++) {
+		for (uint32_t i = 0; i < stages[stage]->file_count; i++)
+			LOG_ERROR("  %s source %u: %s", stage == 0 ? "vertex" : "fragment", i, stages[stage]->files[i]);
+	}
+}
+
+void asset_manager_wait_shaders(void) {
+	uint64_t start = clock_now_ns();
+	uint32_t pending_count, variant_count;
+
+	do {
+		pending_count = variant_count = 0;
+		for (uint32_t i = 0; i < handle_pool_end(g_asset_manager.shaders); i++) {
+			const ShaderFamily *family = shader_family_at(i);
+			if (family == NULL)
+				continue;
+			for (uint32_t mask = 0; mask < (1u << family->feature_count); mask++) {
+				if (family->variants[mask] == NULL)
+					continue;
+
+				variant_count++;
+				OpenGLShaderStatus status = opengl_shader_poll(family->variants[mask]);
+				if (status == OPENGL_SHADER_PENDING) {
+					pending_count++;
+				} else if (status == OPENGL_SHADER_FAILED) {
+					LOG_ERROR("Shader [ %s ] variant 0x%x failed to build", family->name, mask);
+					shader_family_log_files(family);
+					exit(1);
+				}
+			}
+		}
+	} while (pending_count > 0);
+
+	LOG_INFO("Built %u shaders, waited %.2f ms for the driver", variant_count, (clock_now_ns() - start) / 1e6);
+}
+
+// Compiles every variant built so far from the sources a rebuild preprocessed
+static void shader_family_rebuild(ShaderFamily *family, AssetRebuild *rebuild) {
+	shader_preprocess_release(&family->vertex);
+	shader_preprocess_release(&family->fragment);
+	family->vertex = rebuild->vertex;
+	family->fragment = rebuild->fragment;
+	rebuild->vertex = rebuild->fragment = (PreprocessedShader){ 0 };
+	shader_family_watch(family);
+
+	uint32_t reloaded_count = 0;
+	for (uint32_t mask = 0; mask < (1u << family->feature_count); mask++) {
+		if (family->variants[mask] == NULL)
+			continue;
+
+		char *vertex_shader_source = shader_preprocess_variant(&family->vertex, family->features, family->feature_count, mask);
+		char *fragment_shader_source = shader_preprocess_variant(&family->fragment, family->features, family->feature_count, mask);
+		if (vertex_shader_source && fragment_shader_source && opengl_shader_reload(family->variants[mask], g_asset_manager.asset_arena, vertex_shader_source, fragment_shader_source))
+			reloaded_count++;
+		else
+			shader_family_log_files(family);
+		free(vertex_shader_source);
+		free(fragment_shader_source);
+	}
+
+	LOG_INFO("Reloaded shader [ %s ], %u variants", family->name, reloaded_count);
+}
+
+static void asset_manager_upload_textures(size_t budget);
+static void asset_manager_rebuild(void);
+static void asset_manager_rebuilt(uint32_t node);
+
+void asset_manager_update(void) {
+	release_queue_update();
+	texture_residency_update();
+	if (g_asset_manager.texture_load_count > 0) {
+		if (g_asset_manager.uploads)
+			opengl_ring_buffer_begin_frame(g_asset_manager.uploads);
+		asset_manager_upload_textures(TEXTURE_UPLOAD_BUDGET);
+	}
+
+	uint32_t generation = file_watcher_generation(g_asset_manager.watcher);
+	if (generation != g_asset_manager.watcher_generation) {
+		g_asset_manager.watcher_generation = generation;
+		if (asset_graph_pending(g_asset_manager.graph) == 0)
+			g_asset_manager.rebuild_start = clock_now_ns();
+
+		// Files can be shared between assets, so every change is collected before rebuilding
+		for (uint32_t i = 0; i < FILE_WATCHER_MAX_FILES; i++) {
+			if (file_watcher_consume(g_asset_manager.watcher, i) && g_asset_manager.file_nodes[i] != HANDLE_INVALID) {
+				asset_graph_invalidate(g_asset_manager.graph, g_asset_manager.file_nodes[i]);
+				g_asset_manager.graph_changed = true;
+			}
+		}
+	}
+
+	if (g_asset_manager.rebuild_count > 0 || g_asset_manager.graph_changed)
+		asset_manager_rebuild();
+}
+
+ShaderHandle asset_manager_find_shader(const char *name) {
+	return (ShaderHandle){ find_handle(g_asset_manager.shader_names, name) };
+}
+
+OpenGLShader *asset_manager_shader(ShaderHandle shader) {
+	return asset_manager_shader_variant(shader, 0);
+}
+
+ShaderHandle asset_manager_acquire_shader(ShaderHandle shader) {
+	ShaderFamily *family = handle_pool_get(g_asset_manager.shaders, shader.id);
+	if (family == NULL)
+		return (ShaderHandle){ HANDLE_INVALID };
+
+	family->references++;
+	return shader;
+}
+
+static void shader_family_destroy(uint32_t handle, ShaderFamily *family) {
+	ht_remove(g_asset_manager.shader_names, family->name);
+	asset_graph_remove(g_asset_manager.graph, family->node);
+	for (uint32_t mask = 0; mask < (1u << family->feature_count); mask++)
+		release_queue_shader(family->variants[mask]);
+	shader_preprocess_release(&family->vertex);
+	shader_preprocess_release(&family->fragment);
+	handle_pool_free(g_asset_manager.shaders, handle);
 }
 
-OpenGLShader *asset_manager_get_shader(const char *name) {
-	return *((OpenGLShader **)ht_search(g_asset_manager.shaders, name));
+void asset_manager_release_shader(ShaderHandle shader) {
+	ShaderFamily *family = handle_pool_get(g_asset_manager.shaders, shader.id);
+	if (family && --family->references == 0)
+		shader_family_destroy(shader.id, family);
+}
+
+static bool texture_path_is_cooked(const char *path) {
+	size_t length = strlen(path);
+	return length > 5 && strcmp(path + length - 5, ".ktx2") == 0;
+}
+
+// Reads a cooked .ktx2 texture the driver can use, otherwise rewrites path to the .png it was
+// cooked from so the caller decodes that instead
+static bool texture_read_cooked(char *path, Ktx2Image *image) {
+	if (!texture_path_is_cooked(path))
+		return false;
+
+	if (asset_file_read_ktx2(path, image)) {
+		if (opengl_texture_ktx2_supported(image->format))
+			return true;
+		ktx2_release(image);
+	}
+
+	size_t length = strlen(path);
+	LOG_INFO("Texture [ %s ] not cooked for this device, loading the source image", path);
+	memcpy(path + length - 5, ".png", 5);
+	return false;
+}
+
+static TextureRegion texture_region_from_cooked(const Ktx2Image *image) {
+	OpenGLTexture *texture = opengl_texture_load_ktx2(NULL, image);
+	return opengl_texture_region(texture, 0, 0, image->width, image->height);
+}
+
+// path is what a rebuild loads again, a changed file rebuilds the texture and everything depending on it
+static TextureHandle texture_asset_create(const char *name, const char *path, MipmapFilter filter, TextureRegion region, TextureAssetStorage storage) {
+	uint32_t handle = handle_pool_alloc(g_asset_manager.textures);
+	if (handle == HANDLE_INVALID) {
+		LOG_ERROR("Texture [ %s ] exceeds the limit of %d textures", name, ASSET_MANAGER_MAX_TEXTURES);
+		exit(1);
+	}
+
+	TextureAsset *asset = handle_pool_get(g_asset_manager.textures, handle);
+	snprintf(asset->name, sizeof(asset->name), "%s", name);
+	snprintf(asset->path, sizeof(asset->path), "%s", path);
+	asset->filter = filter;
+	asset->region = region;
+	asset->storage = storage;
+	asset->references = 1;
+	asset->node = asset_graph_add(g_asset_manager.graph, ASSET_NODE_TEXTURE, handle);
+	asset_manager_depend_on_file(asset->node, path);
+	ht_insert(g_asset_manager.texture_names, name, &handle);
+	return (TextureHandle){ handle };
 }
 
-OpenGLTexture *asset_manager_load_texture(const char *name, const char *path) {
+TextureHandle asset_manager_load_texture(const char *name, const char *path, MipmapFilter filter) {
+	TextureHandle loaded = asset_manager_find_texture(name);
+	if (loaded.id != HANDLE_INVALID)
+		return asset_manager_acquire_texture(loaded);
+
+	char source_path[ASSET_PATH_LENGTH];
+	snprintf(source_path, sizeof(source_path), "%s", path);
+
+	Ktx2Image cooked;
+	if (texture_read_cooked(source_path, &cooked)) {
+		TextureRegion region = texture_region_from_cooked(&cooked);
+		texture_residency_track_cooked(region.texture, &cooked);
+		return texture_asset_create(name, path, filter, region, TEXTURE_ASSET_OWNED);
+	}
 
-	int32_t width, height, channel_count;
-	uint8_t *data = stbi_load(path, &width, &height, &channel_count, 0);
-	if (!data) {
+	AssetImage image;
+	if (!asset_file_load_image(source_path, &image)) {
 		LOG_ERROR("Texture path [ %s ] not found", path);
 		exit(1);
 	}
 
-	OpenGLTexture *new_texture = opengl_texture_load(g_asset_manager.asset_arena, width, height, channel_count, data);
-	stbi_image_free(data);
+	// Atlas pages have no mips, neighbouring regions would bleed into each other's smaller levels
+	TextureRegion region;
+	bool packed = filter == MIPMAP_FILTER_NONE && texture_atlas_add(g_asset_manager.atlas, image.width, image.height, image.channels, image.pixels, &region);
+	if (!packed) {
+		if (filter == MIPMAP_FILTER_NONE)
+			LOG_WARN("Texture [ %s ] (%dx%d) not packed into the atlas", source_path, image.width, image.height);
+		region = opengl_texture_region(opengl_texture_load(NULL, image.width, image.height, image.channels, image.pixels, filter), 0, 0, image.width, image.height);
+		texture_residency_track(region.texture, source_path, filter);
+	}
+	asset_file_release_image(&image);
+
+	return texture_asset_create(name, path, filter, region, packed ? TEXTURE_ASSET_PACKED : TEXTURE_ASSET_OWNED);
+}
+
+static void texture_load_decode(void *user_data) {
+	TextureLoad *load = user_data;
+
+	if (texture_read_cooked(load->path, &load->cooked)) {
+		load->is_cooked = true;
+		__atomic_store_n(&load->state, TEXTURE_LOAD_DECODED, __ATOMIC_RELEASE);
+		return;
+	}
+
+	AssetImage image;
+	if (!asset_file_load_image(load->path, &image)) {
+		__atomic_store_n(&load->state, TEXTURE_LOAD_FAILED, __ATOMIC_RELEASE);
+		return;
+	}
+	load->width = image.width;
+	load->height = image.height;
+	load->channels = image.channels;
+
+	if (load->filter != MIPMAP_FILTER_NONE && mipmap_generate(image.pixels, load->width, load->height, load->channels, true, load->filter, &load->mips)) {
+		asset_file_release_image(&image);
+		__atomic_store_n(&load->state, TEXTURE_LOAD_DECODED, __ATOMIC_RELEASE);
+		return;
+	}
+
+	// Padding here leaves the main thread a single copy into the staging buffer
+	uint8_t *padded = NULL;
+	if (load->filter == MIPMAP_FILTER_NONE && texture_atlas_fits(g_asset_manager.atlas, load->width, load->height))
+		padded = malloc(texture_atlas_padded_size(load->width, load->height));
+	if (padded) {
+		texture_atlas_pad(load->width, load->height, load->channels, image.pixels, padded);
+		asset_file_release_image(&image);
+		load->pixels = padded;
+		load->padded = true;
+	} else {
+		load->image = image;
+	}
+
+	__atomic_store_n(&load->state, TEXTURE_LOAD_DECODED, __ATOMIC_RELEASE);
+}
+
+static void texture_asset_release_storage(TextureAsset *asset) {
+	if (asset->storage == TEXTURE_ASSET_PACKED) {
+		texture_atlas_release(g_asset_manager.atlas, &asset->region);
+	} else if (asset->storage == TEXTURE_ASSET_OWNED) {
+		texture_residency_untrack(asset->region.texture);
+		release_queue_texture(asset->region.texture);
+	}
+}
+
+static void texture_load_finish(TextureLoad *load) {
+	// Released while decoding, nothing was created for it yet
+	TextureAsset *asset = handle_pool_get(g_asset_manager.textures, load->texture.id);
+	if (asset == NULL)
+		return;
+
+	TextureRegion region;
+	TextureAssetStorage storage = TEXTURE_ASSET_OWNED;
+	if (load->is_cooked) {
+		// Compressed blocks cannot share the RGBA8 atlas pages
+		region = texture_region_from_cooked(&load->cooked);
+		texture_residency_track_cooked(region.texture, &load->cooked);
+	} else if (load->mips.pixels) {
+		region = opengl_texture_region(opengl_texture_load_mips(NULL, &load->mips), 0, 0, load->width, load->height);
+		texture_residency_track(region.texture, load->path, load->filter);
+	} else if (!load->padded) {
+		if (load->filter == MIPMAP_FILTER_NONE)
+			LOG_WARN("Texture [ %s ] (%dx%d) not packed into the atlas", load->path, load->width, load->height);
+		region = opengl_texture_region(opengl_texture_load(NULL, load->width, load->height, load->channels, load->image.pixels, MIPMAP_FILTER_NONE), 0, 0, load->width, load->height);
+		texture_residency_track(region.texture, load->path, MIPMAP_FILTER_NONE);
+	} else if (!texture_atlas_allocate(g_asset_manager.atlas, load->width, load->height, &region)) {
+		LOG_ERROR("Texture [ %s ] does not fit in the atlas, keeping the %s", load->path, load->node ? "previous texels" : "placeholder");
+		return;
+	} else {
+		storage = TEXTURE_ASSET_PACKED;
+		size_t size = texture_atlas_padded_size(load->width, load->height);
+		size_t offset;
+		uint8_t *staging = NULL;
+		if (g_asset_manager.uploads && size <= TEXTURE_UPLOAD_BUDGET)
+			staging = opengl_ring_buffer_push(g_asset_manager.uploads, size, 4, &offset);
+
+		if (staging) {
+			memcpy(staging, load->pixels, size);
+			texture_atlas_upload_buffer(&region, opengl_ring_buffer_id(g_asset_manager.uploads), offset);
+		} else {
+			texture_atlas_upload(&region, load->pixels);
+		}
+	}
+
+	// A rebuild replaces the previous texels, the region stays at the same address
+	texture_asset_release_storage(asset);
+	asset->region = region;
+	asset->storage = storage;
+	if (load->node != HANDLE_INVALID)
+		LOG_INFO("Reloaded texture [ %s ]", asset->name);
+}
+
+// Finishes decoded loads in request order until budget bytes were uploaded this call
+static void asset_manager_upload_textures(size_t budget) {
+	size_t uploaded = 0;
+	uint32_t upload_count = 0, remaining = 0;
+
+	for (uint32_t i = 0; i < g_asset_manager.texture_load_count; i++) {
+		TextureLoad *load = g_asset_manager.texture_loads[i];
+		uint32_t state = __atomic_load_n(&load->state, __ATOMIC_ACQUIRE);
+
+		size_t size = 0;
+		if (state == TEXTURE_LOAD_DECODED && load->is_cooked) {
+			for (uint32_t level = 0; level < load->cooked.level_count; level++)
+				size += load->cooked.levels[level].size;
+		} else if (state == TEXTURE_LOAD_DECODED && load->mips.pixels) {
+			size = load->mips.size;
+		} else if (state == TEXTURE_LOAD_DECODED) {
+			size = load->padded ? texture_atlas_padded_size(load->width, load->height) : (size_t)load->width * load->height * load->channels;
+		}
+		if (state == TEXTURE_LOAD_DECODING || (upload_count > 0 && (uploaded >= budget || size > budget - uploaded))) {
+			g_asset_manager.texture_loads[remaining++] = load;
+			continue;
+		}
+
+		if (state == TEXTURE_LOAD_FAILED) {
+			LOG_ERROR("Texture path [ %s ] not found, keeping the %s", load->path, load->node ? "previous texels" : "placeholder");
+		} else {
+			texture_load_finish(load);
+			uploaded += size;
+			upload_count++;
+		}
+		if (load->node != HANDLE_INVALID)
+			asset_manager_rebuilt(load->node);
+		free(load->pixels);
+		asset_file_release_image(&load->image);
+		mipmap_release(&load->mips);
+		ktx2_release(&load->cooked);
+		free(load);
+	}
+
+	g_asset_manager.texture_load_count = remaining;
+}
+
+static void texture_load_submit(TextureHandle texture, const char *path, MipmapFilter filter, uint32_t node) {
+	TextureLoad *load = calloc(1, sizeof(TextureLoad));
+	snprintf(load->path, sizeof(load->path), "%s", path);
+	load->texture = texture;
+	load->filter = filter;
+	load->state = TEXTURE_LOAD_DECODING;
+	load->node = node;
+	g_asset_manager.texture_loads[g_asset_manager.texture_load_count++] = load;
+
+	thread_pool_submit(g_asset_manager.decoders, texture_load_decode, load);
+}
+
+TextureHandle asset_manager_load_texture_async(const char *name, const char *path, MipmapFilter filter) {
+	TextureHandle loaded = asset_manager_find_texture(name);
+	if (loaded.id != HANDLE_INVALID)
+		return asset_manager_acquire_texture(loaded);
+
+	if (g_asset_manager.placeholder == NULL) {
+		const uint8_t white[4] = { 255, 255, 255, 255 };
+		g_asset_manager.placeholder = arena_push_type(g_asset_manager.asset_arena, TextureRegion);
+		texture_atlas_add(g_asset_manager.atlas, 1, 1, 4, white, g_asset_manager.placeholder);
+		if (!opengl_texture_headless())
+			g_asset_manager.uploads = opengl_ring_buffer_create(g_asset_manager.asset_arena, TEXTURE_UPLOAD_BUDGET, TEXTURE_UPLOAD_REGIONS);
+	}
+
+	size_t path_length = strlen(path);
+	if (g_asset_manager.texture_load_count == ASSET_MANAGER_MAX_TEXTURE_LOADS || path_length >= ASSET_PATH_LENGTH)
+		return asset_manager_load_texture(name, path, filter);
+
+	TextureHandle texture = texture_asset_create(name, path, filter, *g_asset_manager.placeholder, TEXTURE_ASSET_PLACEHOLDER);
+	texture_load_submit(texture, path, filter, HANDLE_INVALID);
+	return texture;
+}
+
+uint32_t asset_manager_pending_textures(void) {
+	return g_asset_manager.texture_load_count;
+}
+
+void asset_manager_wait_textures(void) {
+	uint64_t start = clock_now_ns();
+	while (g_asset_manager.texture_load_count > 0)
+		asset_manager_upload_textures(SIZE_MAX);
+	LOG_INFO("Waited %.2f ms for textures", (clock_now_ns() - start) / 1e6);
+}
+
+TextureHandle asset_manager_find_texture(const char *name) {
+	return (TextureHandle){ find_handle(g_asset_manager.texture_names, name) };
+}
+
+TextureRegion *asset_manager_texture(TextureHandle texture) {
+	TextureAsset *asset = handle_pool_get(g_asset_manager.textures, texture.id);
+	return asset ? &asset->region : NULL;
+}
+
+TextureHandle asset_manager_acquire_texture(TextureHandle texture) {
+	TextureAsset *asset = handle_pool_get(g_asset_manager.textures, texture.id);
+	if (asset == NULL)
+		return (TextureHandle){ HANDLE_INVALID };
+
+	asset->references++;
+	return texture;
+}
+
+static void texture_asset_destroy(uint32_t handle, TextureAsset *asset) {
+	ht_remove(g_asset_manager.texture_names, asset->name);
+	asset_graph_remove(g_asset_manager.graph, asset->node);
+	texture_asset_release_storage(asset);
+	handle_pool_free(g_asset_manager.textures, handle);
+}
+
+void asset_manager_release_texture(TextureHandle texture) {
+	TextureAsset *asset = handle_pool_get(g_asset_manager.textures, texture.id);
+	if (asset && --asset->references == 0)
+		texture_asset_destroy(texture.id, asset);
+}
+
+LevelHandle asset_manager_load_level(const char *name, const char *path, const TextureHandle *textures, uint32_t texture_count) {
+	LevelHandle loaded = asset_manager_find_level(name);
+	if (loaded.id != HANDLE_INVALID)
+		return asset_manager_acquire_level(loaded);
+
+	if (texture_count > ASSET_MANAGER_MAX_LEVEL_TEXTURES) {
+		LOG_ERROR("Level [ %s ] uses more than %d textures", name, ASSET_MANAGER_MAX_LEVEL_TEXTURES);
+		return (LevelHandle){ HANDLE_INVALID };
+	}
+
+	LevelTiles tiles;
+	if (!asset_file_load_level(path, &tiles)) {
+		LOG_ERROR("Level path [ %s ] not found", path);
+		return (LevelHandle){ HANDLE_INVALID };
+	}
+
+	uint32_t handle = handle_pool_alloc(g_asset_manager.levels);
+	if (handle == HANDLE_INVALID) {
+		LOG_ERROR("Level [ %s ] exceeds the limit of %d levels", name, ASSET_MANAGER_MAX_LEVELS);
+		level_file_release(&tiles);
+		return (LevelHandle){ HANDLE_INVALID };
+	}
+
+	LevelAsset *level = handle_pool_get(g_asset_manager.levels, handle);
+	snprintf(level->name, sizeof(level->name), "%s", name);
+	snprintf(level->path, sizeof(level->path), "%s", path);
+	level->tiles = tiles;
+	level->references = 1;
+	level->node = asset_graph_add(g_asset_manager.graph, ASSET_NODE_LEVEL, handle);
+	asset_manager_depend_on_file(level->node, path);
+	for (uint32_t i = 0; i < texture_count; i++) {
+		TextureHandle texture = asset_manager_acquire_texture(textures[i]);
+		TextureAsset *asset = handle_pool_get(g_asset_manager.textures, texture.id);
+		if (asset == NULL)
+			continue;
+		level->textures[level->texture_count++] = texture;
+		asset_graph_depend(g_asset_manager.graph, level->node, asset->node);
+	}
+
+	ht_insert(g_asset_manager.level_names, name, &handle);
+	return (LevelHandle){ handle };
+}
+
+LevelHandle asset_manager_find_level(const char *name) {
+	return (LevelHandle){ find_handle(g_asset_manager.level_names, name) };
+}
+
+const LevelTiles *asset_manager_level(LevelHandle level) {
+	LevelAsset *asset = handle_pool_get(g_asset_manager.levels, level.id);
+	return asset ? &asset->tiles : NULL;
+}
+
+uint32_t asset_manager_level_version(LevelHandle level) {
+	LevelAsset *asset = handle_pool_get(g_asset_manager.levels, level.id);
+	return asset ? asset->version : 0;
+}
+
+LevelHandle asset_manager_acquire_level(LevelHandle level) {
+	LevelAsset *asset = handle_pool_get(g_asset_manager.levels, level.id);
+	if (asset == NULL)
+		return (LevelHandle){ HANDLE_INVALID };
+
+	asset->references++;
+	return level;
+}
+
+static void level_asset_destroy(uint32_t handle, LevelAsset *level) {
+	ht_remove(g_asset_manager.level_names, level->name);
+	asset_graph_remove(g_asset_manager.graph, level->node);
+	level_file_release(&level->tiles);
+	for (uint32_t i = 0; i < level->texture_count; i++)
+		asset_manager_release_texture(level->textures[i]);
+	handle_pool_free(g_asset_manager.levels, handle);
+}
+
+void asset_manager_release_level(LevelHandle level) {
+	LevelAsset *asset = handle_pool_get(g_asset_manager.levels, level.id);
+	if (asset && --asset->references == 0)
+		level_asset_destroy(level.id, asset);
+}
+
+static void asset_rebuild_run(void *user_data) {
+	AssetRebuild *rebuild = user_data;
+
+	bool success;
+	if (rebuild->kind == ASSET_NODE_SHADER) {
+		bool vertex_success = shader_preprocess(rebuild->vertex_path, &rebuild->vertex);
+		bool fragment_success = shader_preprocess(rebuild->fragment_path, &rebuild->fragment);
+		success = vertex_success && fragment_success;
+	} else {
+		success = asset_file_load_level(rebuild->path, &rebuild->tiles);
+	}
+
+	__atomic_store_n(&rebuild->state, success ? ASSET_REBUILD_DONE : ASSET_REBUILD_FAILED, __ATOMIC_RELEASE);
+}
+
+static void asset_rebuild_free(AssetRebuild *rebuild) {
+	shader_preprocess_release(&rebuild->vertex);
+	shader_preprocess_release(&rebuild->fragment);
+	level_file_release(&rebuild->tiles);
+	free(rebuild);
+}
+
+// A file may be briefly missing while an editor replaces it, the next change retries
+static void asset_rebuild_finish(AssetRebuild *rebuild, bool success) {
+	uint32_t asset = asset_graph_asset(g_asset_manager.graph, rebuild->node);
+	if (rebuild->kind == ASSET_NODE_SHADER) {
+		ShaderFamily *family = handle_pool_get(g_asset_manager.shaders, asset);
+		if (family && success)
+			shader_family_rebuild(family, rebuild);
+		return;
+	}
 
-	ht_insert(g_asset_manager.textures, name, &new_texture);
-	return new_texture;
+	// Rebuilt for its textures as well, so a level that keeps its old tiles still moves its
+	// version for whatever was built from the old regions
+	LevelAsset *level = handle_pool_get(g_asset_manager.levels, asset);
+	if (level == NULL)
+		return;
+	if (success) {
+		level_file_release(&level->tiles);
+		level->tiles = rebuild->tiles;
+		rebuild->tiles = (LevelTiles){ 0 };
+		LOG_INFO("Reloaded level [ %s ], %ux%u tiles", level->name, level->tiles.columns, level->tiles.rows);
+	}
+	level->version++;
 }
 
-OpenGLTexture *asset_manager_get_texture(const char *name) {
-	return *((OpenGLTexture **)ht_search(g_asset_manager.textures, name));
+// Shader and level sources are read on the thread pool, textures go through the async loads
+static void asset_manager_start_rebuild(uint32_t node) {
+	AssetNodeKind kind = asset_graph_kind(g_asset_manager.graph, node);
+	uint32_t asset = asset_graph_asset(g_asset_manager.graph, node);
+	if (kind == ASSET_NODE_FILE) {
+		asset_manager_rebuilt(node);
+		return;
+	}
+	if (kind == ASSET_NODE_TEXTURE) {
+		TextureAsset *texture = handle_pool_get(g_asset_manager.textures, asset);
+		texture_load_submit((TextureHandle){ asset }, texture->path, texture->filter, node);
+		return;
+	}
+
+	AssetRebuild *rebuild = calloc(1, sizeof(AssetRebuild));
+	rebuild->node = node;
+	rebuild->kind = kind;
+	rebuild->state = ASSET_REBUILD_RUNNING;
+	if (kind == ASSET_NODE_SHADER) {
+		ShaderFamily *family = handle_pool_get(g_asset_manager.shaders, asset);
+		rebuild->vertex_path = family->vertex_path;
+		rebuild->fragment_path = family->fragment_path;
+	} else {
+		LevelAsset *level = handle_pool_get(g_asset_manager.levels, asset);
+		memcpy(rebuild->path, level->path, sizeof(rebuild->path));
+	}
+	g_asset_manager.rebuilds[g_asset_manager.rebuild_count++] = rebuild;
+
+	thread_pool_submit(g_asset_manager.decoders, asset_rebuild_run, rebuild);
+}
+
+static void asset_manager_rebuilt(uint32_t node) {
+	if (asset_graph_kind(g_asset_manager.graph, node) != ASSET_NODE_FILE)
+		g_asset_manager.rebuilt_count++;
+	asset_graph_rebuilt(g_asset_manager.graph, node);
+	g_asset_manager.graph_changed = true;
+}
+
+// Finishes rebuilds whose files were read, then starts every node whose dependencies are all
+// rebuilt, which walks the invalidated part of the graph in topological order
+static void asset_manager_rebuild(void) {
+	uint32_t remaining = 0;
+	for (uint32_t i = 0; i < g_asset_manager.rebuild_count; i++) {
+		AssetRebuild *rebuild = g_asset_manager.rebuilds[i];
+		uint32_t state = __atomic_load_n(&rebuild->state, __ATOMIC_ACQUIRE);
+		if (state == ASSET_REBUILD_RUNNING) {
+			g_asset_manager.rebuilds[remaining++] = rebuild;
+			continue;
+		}
+
+		asset_rebuild_finish(rebuild, state == ASSET_REBUILD_DONE);
+		asset_manager_rebuilt(rebuild->node);
+		asset_rebuild_free(rebuild);
+	}
+	g_asset_manager.rebuild_count = remaining;
+
+	if (!g_asset_manager.graph_changed)
+		return;
+	g_asset_manager.graph_changed = false;
+
+	uint32_t ready[ASSET_MANAGER_MAX_REBUILDS];
+	for (;;) {
+		uint32_t rebuild_slots = ASSET_MANAGER_MAX_REBUILDS - g_asset_manager.rebuild_count;
+		uint32_t load_slots = ASSET_MANAGER_MAX_TEXTURE_LOADS - g_asset_manager.texture_load_count;
+		uint32_t count = asset_graph_take_ready(g_asset_manager.graph, ready, rebuild_slots < load_slots ? rebuild_slots : load_slots);
+		if (count == 0)
+			break;
+		for (uint32_t i = 0; i < count; i++)
+			asset_manager_start_rebuild(ready[i]);
+	}
+	g_asset_manager.graph_changed = false;
+
+	if (g_asset_manager.rebuilt_count > 0 && asset_graph_pending(g_asset_manager.graph) == 0) {
+		LOG_INFO("Rebuilt %u assets in %.2f ms", g_asset_manager.rebuilt_count, (clock_now_ns() - g_asset_manager.rebuild_start) / 1e6);
+		g_asset_manager.rebuilt_count = 0;
+	}
 }
@@ -1,13 +1,96 @@
 #pragma once
 
+#include "level_file.h"
 #include "shader.h"
 #include "texture.h"
 
+// Archive mounted by the next asset_manager_startup, "assets.pak" by default. NULL loads loose
+// files only, otherwise they are the fallback for anything the archive lacks.
+void asset_manager_set_archive(const char *path);
 void asset_manager_startup();
 void asset_manager_shutdown();
+// Uploads decoded textures, evicts textures over the residency budget and rebuilds assets whose
+// source files changed on disk
+void asset_manager_update(void);
 
-OpenGLShader *asset_manager_load_shader(const char *name, const char *vertex_shader_path, const char *fragment_shader_path);
-OpenGLShader *asset_manager_get_shader(const char *name);
+// Generational handles returned by the load functions, names are only looked up while loading.
+// Resolving a handle is an array index, a handle to an unloaded asset resolves to NULL.
+// A zeroed handle is never valid.
+// Every load and acquire holds a reference, the asset is unloaded when the last one is released.
+// Its GL objects are deleted once the GPU finished the frames that could still use them.
+typedef struct {
+	uint32_t id;
+} TextureHandle;
 
-OpenGLTexture *asset_manager_load_texture(const char *name, const char *path);
-OpenGLTexture *asset_manager_get_texture(const char *name);
+typedef struct {
+	uint32_t id;
+} ShaderHandle;
+
+typedef struct {
+	uint32_t id;
+} LevelHandle;
+
+// Assets record what they are built from: shaders their files and includes, textures their image,
+// levels their tiles and the textures they are drawn with. A changed loose file rebuilds only the
+// assets depending on it, in dependency order, with the files read on worker threads. Archived
+// files never change and are not watched.
+
+#define ASSET_MANAGER_MAX_SHADER_FEATURES 8
+
+// Shaders are submitted without waiting for the driver, call asset_manager_wait_shaders once
+// every shader is loaded so their builds overlap. Using a shader before that waits for it alone.
+// A plain shader is a family without features. Loading a loaded name acquires it again.
+ShaderHandle asset_manager_load_shader(const char *name, const char *vertex_shader_path, const char *fragment_shader_path);
+// Polls every pending shader until all are built, exits on a compile or link error
+void asset_manager_wait_shaders(void);
+// An invalid handle when no shader of that name is loaded
+ShaderHandle asset_manager_find_shader(const char *name);
+// The variant without features
+OpenGLShader *asset_manager_shader(ShaderHandle shader);
+// Returns an invalid handle when shader was already unloaded
+ShaderHandle asset_manager_acquire_shader(ShaderHandle shader);
+void asset_manager_release_shader(ShaderHandle shader);
+
+// Sources are preprocessed once, resolving #include. A variant is compiled on its first request
+// with "#define features[i] 1" for every bit i set in its mask. Later requests are an array
+// lookup, so variants can be fetched on the draw path.
+ShaderHandle asset_manager_load_shader_family(const char *name, const char *vertex_shader_path, const char *fragment_shader_path, const char *const *features, uint32_t feature_count);
+OpenGLShader *asset_manager_shader_variant(ShaderHandle shader, uint32_t feature_mask);
+
+// Images are packed into shared atlas pages, the region holds the page and UV bounds.
+// Any filter but MIPMAP_FILTER_NONE gives the image a texture of its own with a mip chain built
+// by that filter, for sprites drawn smaller than their source.
+// A .ktx2 path from the texture cooker keeps its block compression and mip chain in a texture
+// of its own, and falls back to the .png of the same name when missing or unsupported.
+// Loading a loaded name acquires it again.
+TextureHandle asset_manager_load_texture(const char *name, const char *path, MipmapFilter filter);
+// Decodes on a worker thread and resolves to a white placeholder region right away. The region is
+// overwritten in place by asset_manager_update once its texels are uploaded, which streams them
+// through a pixel unpack buffer within a per-frame byte budget. Anything that copies the region's
+// UVs, like an instance layer, has to wait for the load to finish first. Mip chains are built on
+// the worker too.
+TextureHandle asset_manager_load_texture_async(const char *name, const char *path, MipmapFilter filter);
+uint32_t asset_manager_pending_textures(void);
+// Uploads every pending texture without a budget, blocking until their decodes finish
+void asset_manager_wait_textures(void);
+TextureHandle asset_manager_find_texture(const char *name);
+// The region stays at the same address until the texture is unloaded
+TextureRegion *asset_manager_texture(TextureHandle texture);
+// Returns an invalid handle when texture was already unloaded
+TextureHandle asset_manager_acquire_texture(TextureHandle texture);
+// A pending decode of an unloaded texture is dropped once it finishes. Atlas space comes back
+// once every region on its page was released.
+void asset_manager_release_texture(TextureHandle texture);
+
+// Tiles of a level, holding a reference to every texture it is drawn with. Returns an invalid
+// handle when the level cannot be read. Loading a loaded name acquires it again.
+LevelHandle asset_manager_load_level(const char *name, const char *path, const TextureHandle *textures, uint32_t texture_count);
+LevelHandle asset_manager_find_level(const char *name);
+// NULL once the level is unloaded
+const LevelTiles *asset_manager_level(LevelHandle level);
+// Bumped whenever the level is rebuilt, after its file or one of its textures changed. Anything
+// built from the tiles or from the regions of those textures is stale once the version moves.
+uint32_t asset_manager_level_version(LevelHandle level);
+// Returns an invalid handle when level was already unloaded
+LevelHandle asset_manager_acquire_level(LevelHandle level);
+void asset_manager_release_level(LevelHandle level);
@@ -0,0 +1,295 @@
+#include "atlas.h"
+
+#include "core/arena.h"
+#include "core/logger.h"
+#include "texture.h"
+#include "texture_residency.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ATLAS_MAX_PAGES 16
+#define ATLAS_INITIAL_LAYERS 1
+#define ATLAS_PADDING 1
+
+typedef struct {
+	uint32_t x, y, width;
+} SkylineNode;
+
+typedef struct {
+	OpenGLTexture *texture;
+	SkylineNode *nodes;
+	uint32_t node_count;
+	// Regions not yet released, the page is packed from scratch again once it drops to 0
+	uint32_t region_count;
+} AtlasPage;
+
+struct _texture_atlas {
+	Arena *arena;
+	uint32_t page_width, page_height;
+
+	AtlasPage pages[ATLAS_MAX_PAGES];
+	uint32_t page_count;
+	// In array mode every page is a layer of this texture
+	OpenGLTexture *array;
+};
+
+TextureAtlas *texture_atlas_create(Arena *arena, uint32_t page_width, uint32_t page_height) {
+	TextureAtlas *atlas = arena_push_type(arena, TextureAtlas);
+	*atlas = (TextureAtlas){
+		.arena = arena,
+		.page_width = page_width,
+		.page_height = page_height,
+	};
+	return atlas;
+}
+
+static AtlasPage *atlas_add_page(TextureAtlas *atlas) {
+	if (atlas->page_count == ATLAS_MAX_PAGES) {
+		LOG_ERROR("ATLAS: All %d pages in use", ATLAS_MAX_PAGES);
+		return NULL;
+	}
+
+	OpenGLTexture *texture = NULL;
+	if (opengl_texture_array_mode()) {
+		if (atlas->array == NULL) {
+			atlas->array = opengl_texture_load_array(atlas->arena, atlas->page_width, atlas->page_height, ATLAS_INITIAL_LAYERS);
+			texture_residency_pin(atlas->array);
+		} else if (atlas->page_count == atlas->array->layer_count) {
+			// Doubling keeps the copies rare, the layers are cleared so unused ones cost only memory
+			uint32_t layer_count = atlas->array->layer_count * 2 < ATLAS_MAX_PAGES ? atlas->array->layer_count * 2 : ATLAS_MAX_PAGES;
+			size_t previous_size = atlas->array->size;
+			opengl_texture_resize_array(atlas->array, layer_count);
+			texture_residency_resized(atlas->array, previous_size);
+			LOG_INFO("ATLAS: Grew page array to %d layers", layer_count);
+		}
+		texture = atlas->array;
+	} else {
+		texture = opengl_texture_load(atlas->arena, atlas->page_width, atlas->page_height, 4, NULL, MIPMAP_FILTER_NONE);
+		texture_residency_pin(texture);
+	}
+
+	AtlasPage *page = &atlas->pages[atlas->page_count++];
+	*page = (AtlasPage){
+		.texture = texture,
+		.nodes = arena_push_array(atlas->arena, SkylineNode, atlas->page_width + 1),
+		.node_count = 1,
+	};
+	page->nodes[0] = (SkylineNode){ 0, 0, atlas->page_width };
+
+	LOG_INFO("ATLAS: Created page %d (%dx%d)", atlas->page_count - 1, atlas->page_width, atlas->page_height);
+	return page;
+}
+
+// Height at which a rectangle of the given width rests when its left edge sits on node index,
+// or -1 if it does not fit from there
+static int64_t skyline_fit(const TextureAtlas *atlas, const AtlasPage *page, uint32_t index, uint32_t width, uint32_t height) {
+	uint32_t x = page->nodes[index].x;
+	if (x + width > atlas->page_width)
+		return -1;
+
+	uint32_t y = 0;
+	int64_t width_left = width;
+	for (uint32_t i = index; width_left > 0; i++) {
+		if (i == page->node_count)
+			return -1;
+		if (page->nodes[i].y > y)
+			y = page->nodes[i].y;
+		if (y + height > atlas->page_height)
+			return -1;
+		width_left -= page->nodes[i].width;
+	}
+	return y;
+}
+
+static bool skyline_insert(TextureAtlas *atlas, AtlasPage *page, uint32_t width, uint32_t height, uint32_t *out_x, uint32_t *out_y) {
+	int64_t best_index = -1;
+	uint32_t best_bottom = UINT32_MAX, best_width = UINT32_MAX;
+
+	for (uint32_t i = 0; i < page->node_count; i++) {
+		int64_t y = skyline_fit(atlas, page, i, width, height);
+		if (y < 0)
+			continue;
+
+		uint32_t bottom = (uint32_t)y + height;
+		if (bottom < best_bottom || (bottom == best_bottom && page->nodes[i].width < best_width)) {
+			best_index = i;
+			best_bottom = bottom;
+			best_width = page->nodes[i].width;
+			*out_y = (uint32_t)y;
+		}
+	}
+
+	if (best_index < 0)
+		return false;
+
+	uint32_t index = (uint32_t)best_index;
+	*out_x = page->nodes[index].x;
+
+	// Insert the new top edge and shrink or remove the nodes it now covers
+	memmove(&page->nodes[index + 1], &page->nodes[index], (page->node_count - index) * sizeof(SkylineNode));
+	page->nodes[index] = (SkylineNode){ *out_x, *out_y + height, width };
+	page->node_count++;
+
+	for (uint32_t i = index + 1; i < page->node_count; i++) {
+		SkylineNode *previous = &page->nodes[i - 1];
+		SkylineNode *node = &page->nodes[i];
+		if (node->x >= previous->x + previous->width)
+			break;
+
+		uint32_t shrink = previous->x + previous->width - node->x;
+		if (node->width > shrink) {
+			node->x += shrink;
+			node->width -= shrink;
+			break;
+		}
+
+		memmove(node, node + 1, (page->node_count - i - 1) * sizeof(SkylineNode));
+		page->node_count--;
+		i--;
+	}
+
+	// Merge neighbours at the same height
+	for (uint32_t i = 0; i + 1 < page->node_count; i++) {
+		if (page->nodes[i].y == page->nodes[i + 1].y) {
+			page->nodes[i].width += page->nodes[i + 1].width;
+			memmove(&page->nodes[i + 1], &page->nodes[i + 2], (page->node_count - i - 2) * sizeof(SkylineNode));
+			page->node_count--;
+			i--;
+		}
+	}
+
+	return true;
+}
+
+bool texture_atlas_fits(const TextureAtlas *atlas, uint32_t width, uint32_t height) {
+	return width + 2 * ATLAS_PADDING <= atlas->page_width && height + 2 * ATLAS_PADDING <= atlas->page_height;
+}
+
+bool texture_atlas_allocate(TextureAtlas *atlas, uint32_t width, uint32_t height, TextureRegion *region) {
+	if (!texture_atlas_fits(atlas, width, height))
+		return false;
+
+	uint32_t padded_width = width + 2 * ATLAS_PADDING, padded_height = height + 2 * ATLAS_PADDING;
+	AtlasPage *page = NULL;
+	uint32_t x = 0, y = 0;
+	for (uint32_t i = 0; i < atlas->page_count && page == NULL; i++) {
+		if (skyline_insert(atlas, &atlas->pages[i], padded_width, padded_height, &x, &y))
+			page = &atlas->pages[i];
+	}
+	if (page == NULL) {
+		if ((page = atlas_add_page(atlas)) == NULL)
+			return false;
+		skyline_insert(atlas, page, padded_width, padded_height, &x, &y);
+	}
+
+	*region = opengl_texture_region(page->texture, x + ATLAS_PADDING, y + ATLAS_PADDING, width, height);
+	if (page->texture->layer_count)
+		region->layer = (uint32_t)(page - atlas->pages);
+	page->region_count++;
+	return true;
+}
+
+void texture_atlas_release(TextureAtlas *atlas, const TextureRegion *region) {
+	AtlasPage *page = NULL;
+	if (atlas->array && region->texture == atlas->array && region->layer < atlas->page_count) {
+		page = &atlas->pages[region->layer];
+	} else {
+		for (uint32_t i = 0; i < atlas->page_count && page == NULL; i++) {
+			if (atlas->pages[i].texture == region->texture)
+				page = &atlas->pages[i];
+		}
+	}
+	if (page == NULL || page->region_count == 0) {
+		LOG_WARN("ATLAS: Released a region that is not in the atlas");
+		return;
+	}
+
+	// Skyline packing cannot reclaim single rectangles, so space only comes back with the whole
+	// page. The old texels stay until overwritten, uploads are ordered after the draws reading them.
+	if (--page->region_count == 0) {
+		page->nodes[0] = (SkylineNode){ 0, 0, atlas->page_width };
+		page->node_count = 1;
+	}
+}
+
+size_t texture_atlas_padded_size(uint32_t width, uint32_t height) {
+	return (size_t)(width + 2 * ATLAS_PADDING) * (height + 2 * ATLAS_PADDING) * 4;
+}
+
+void texture_atlas_pad(uint32_t width, uint32_t height, uint32_t channels, const uint8_t *pixels, uint8_t *padded) {
+	uint32_t padded_width = width + 2 * ATLAS_PADDING, padded_height = height + 2 * ATLAS_PADDING;
+
+	for (uint32_t y = 0; y < padded_height; y++) {
+		uint32_t source_y = y < ATLAS_PADDING ? 0 : (y - ATLAS_PADDING >= height ? height - 1 : y - ATLAS_PADDING);
+		for (uint32_t x = 0; x < padded_width; x++) {
+			uint32_t source_x = x < ATLAS_PADDING ? 0 : (x - ATLAS_PADDING >= width ? width - 1 : x - ATLAS_PADDING);
+			const uint8_t *source = pixels + ((size_t)source_y * width + source_x) * channels;
+			uint8_t *destination = padded + ((size_t)y * padded_width + x) * 4;
+
+			switch (channels) {
+				case 1: {
+					destination[0] = destination[1] = destination[2] = source[0];
+					destination[3] = 255;
+				} break;
+				case 2: {
+					destination[0] = destination[1] = destination[2] = source[0];
+					destination[3] = source[1];
+				} break;
+				case 3: {
+					memcpy(destination, source, 3);
+					destination[3] = 255;
+				} break;
+				default: {
+					memcpy(destination, source, 4);
+				} break;
+			}
+		}
+	}
+}
+
+void texture_atlas_upload(const TextureRegion *region, const uint8_t *padded) {
+	opengl_texture_update(region->texture, region->layer, region->x - ATLAS_PADDING, region->y - ATLAS_PADDING,
+		region->width + 2 * ATLAS_PADDING, region->height + 2 * ATLAS_PADDING, 4, padded);
+}
+
+void texture_atlas_upload_buffer(const TextureRegion *region, uint32_t buffer, size_t offset) {
+	opengl_texture_update_buffer(region->texture, region->layer, region->x - ATLAS_PADDING, region->y - ATLAS_PADDING,
+		region->width + 2 * ATLAS_PADDING, region->height + 2 * ATLAS_PADDING, buffer, offset);
+}
+
+bool texture_atlas_add(TextureAtlas *atlas, uint32_t width, uint32_t height, uint32_t channels, const uint8_t *pixels, TextureRegion *region) {
+	if (!texture_atlas_fits(atlas, width, height))
+		return false;
+
+	uint8_t *padded = malloc(texture_atlas_padded_size(width, height));
+	if (padded == NULL) {
+		LOG_ERROR("ATLAS: Out of memory padding %dx%d image", width, height);
+		return false;
+	}
+
+	if (!texture_atlas_allocate(atlas, width, height, region)) {
+		free(padded);
+		return false;
+	}
+
+	texture_atlas_pad(width, height, channels, pixels, padded);
+	texture_atlas_upload(region, padded);
+	free(padded);
+	return true;
+}
+
+void texture_atlas_destroy(TextureAtlas *atlas) {
+	for (uint32_t i = 0; i < atlas->page_count; i++) {
+		if (atlas->pages[i].texture != atlas->array)
+			opengl_texture_destroy(atlas->pages[i].texture);
+	}
+	opengl_texture_destroy(atlas->array);
+	atlas->array = NULL;
+	atlas->page_count = 0;
+}
+
+uint32_t texture_atlas_page_count(const TextureAtlas *atlas) {
+	return atlas->page_count;
+}
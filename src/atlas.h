@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct _arena Arena;
+typedef struct _texture_region TextureRegion;
+typedef struct _texture_atlas TextureAtlas;
+
+// Packs images into shared RGBA8 pages with a skyline bottom-left packer. Every image gets a
+// one texel border extruded from its edges so filtering never samples a neighbour.
+TextureAtlas *texture_atlas_create(Arena *arena, uint32_t page_width, uint32_t page_height);
+// Deletes the pages, the GPU must be done with them
+void texture_atlas_destroy(TextureAtlas *atlas);
+
+// Returns false if the image does not fit in an empty page or all pages are in use
+bool texture_atlas_add(TextureAtlas *atlas, uint32_t width, uint32_t height, uint32_t channels, const uint8_t *pixels, TextureRegion *region);
+
+// The steps of texture_atlas_add, so decoding and padding can happen off the main thread and the
+// texels can be streamed from a pixel unpack buffer. The fits and pad functions are thread safe.
+bool texture_atlas_fits(const TextureAtlas *atlas, uint32_t width, uint32_t height);
+// Reserves space for the image and fills region with its page and UV bounds
+bool texture_atlas_allocate(TextureAtlas *atlas, uint32_t width, uint32_t height, TextureRegion *region);
+// Expands the image to RGBA with its edges repeated into the border, texture_atlas_padded_size bytes
+size_t texture_atlas_padded_size(uint32_t width, uint32_t height);
+void texture_atlas_pad(uint32_t width, uint32_t height, uint32_t channels, const uint8_t *pixels, uint8_t *padded);
+void texture_atlas_upload(const TextureRegion *region, const uint8_t *padded);
+void texture_atlas_upload_buffer(const TextureRegion *region, uint32_t buffer, size_t offset);
+// Gives the region's space back, a page is reused once every region on it was released
+void texture_atlas_release(TextureAtlas *atlas, const TextureRegion *region);
+
+uint32_t texture_atlas_page_count(const TextureAtlas *atlas);
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// Monotonic time in nanoseconds, only meaningful as a difference
+uint64_t clock_now_ns(void);
@@ -0,0 +1,126 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "file.h"
+
+#include "logger.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+char *file_read_text(const char *path) {
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		LOG_ERROR("FILE: %s: %s", path, strerror(errno));
+		return NULL;
+	}
+
+	if (fseek(file, 0, SEEK_END) == -1)
+		LOG_ERROR("FILE: %s", strerror(errno));
+	long size = ftell(file);
+	rewind(file);
+
+	char *source = size >= 0 ? malloc(size + 1) : NULL;
+	if (source == NULL) {
+		fclose(file);
+		return NULL;
+	}
+
+	size_t length = fread(source, 1, size, file);
+	fclose(file);
+
+	source[length] = '\0';
+	return source;
+}
+
+#ifndef _WIN32
+
+bool file_map(const char *path, FileMapping *mapping) {
+	*mapping = (FileMapping){ 0 };
+
+	int descriptor = open(path, O_RDONLY);
+	if (descriptor == -1) {
+		if (errno != ENOENT)
+			LOG_ERROR("FILE: %s: %s", path, strerror(errno));
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(descriptor, &status) == -1 || status.st_size == 0) {
+		LOG_ERROR("FILE: %s: Cannot map an empty or unreadable file", path);
+		close(descriptor);
+		return false;
+	}
+
+	// The mapping keeps its own reference to the file
+	void *data = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	close(descriptor);
+	if (data == MAP_FAILED) {
+		LOG_ERROR("FILE: %s: %s", path, strerror(errno));
+		return false;
+	}
+
+	mapping->data = data;
+	mapping->size = (size_t)status.st_size;
+	return true;
+}
+
+void file_unmap(FileMapping *mapping) {
+	if (mapping->data)
+		munmap((void *)mapping->data, mapping->size);
+	*mapping = (FileMapping){ 0 };
+}
+
+#else
+
+bool file_map(const char *path, FileMapping *mapping) {
+	*mapping = (FileMapping){ 0 };
+
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	HANDLE view = NULL;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+		view = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (view == NULL) {
+		LOG_ERROR("FILE: %s: Cannot map file (error %lu)", path, GetLastError());
+		return false;
+	}
+
+	const void *data = MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0);
+	if (data == NULL) {
+		LOG_ERROR("FILE: %s: Cannot map file (error %lu)", path, GetLastError());
+		CloseHandle(view);
+		return false;
+	}
+
+	mapping->data = data;
+	mapping->size = (size_t)size.QuadPart;
+	mapping->handle = view;
+	return true;
+}
+
+void file_unmap(FileMapping *mapping) {
+	if (mapping->data) {
+		UnmapViewOfFile(mapping->data);
+		CloseHandle(mapping->handle);
+	}
+	*mapping = (FileMapping){ 0 };
+}
+
+#endif
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Returns a malloc'd, null terminated copy of the file or NULL
+char *file_read_text(const char *path);
+
+// A read-only view of a whole file, valid until file_unmap
+typedef struct {
+	const uint8_t *data;
+	size_t size;
+	void *handle;
+} FileMapping;
+
+// Returns false without logging when the file does not exist
+bool file_map(const char *path, FileMapping *mapping);
+void file_unmap(FileMapping *mapping);
@@ -0,0 +1,241 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "file_watcher.h"
+
+#include "arena.h"
+#include "logger.h"
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#define FILE_WATCHER_MAX_DIRECTORIES 16
+#define FILE_WATCHER_PATH_LENGTH 256
+
+// Editors commonly save through a temporary file and a rename, so directories are watched
+// instead of the files themselves and events are matched by name.
+#define FILE_WATCHER_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE)
+
+typedef struct {
+	char path[FILE_WATCHER_PATH_LENGTH];
+	const char *name; // Points into path, after the last separator
+	uint32_t directory;
+	uint32_t changed;
+} WatchedFile;
+
+typedef struct {
+	char path[FILE_WATCHER_PATH_LENGTH];
+	int32_t descriptor;
+} WatchedDirectory;
+
+struct _file_watcher {
+	int32_t inotify;
+	int32_t wake[2];
+	pthread_t thread;
+	pthread_mutex_t mutex;
+
+	uint32_t generation;
+
+	WatchedFile files[FILE_WATCHER_MAX_FILES];
+	uint32_t file_count;
+	WatchedDirectory directories[FILE_WATCHER_MAX_DIRECTORIES];
+	uint32_t directory_count;
+};
+
+static void watcher_handle_event(FileWatcher *watcher, const struct inotify_event *event) {
+	if (event->len == 0)
+		return;
+
+	bool changed = false;
+	pthread_mutex_lock(&watcher->mutex);
+	for (uint32_t i = 0; i < watcher->file_count; i++) {
+		WatchedFile *file = &watcher->files[i];
+		if (watcher->directories[file->directory].descriptor != event->wd || strcmp(file->name, event->name) != 0)
+			continue;
+		__atomic_store_n(&file->changed, 1, __ATOMIC_RELAXED);
+		changed = true;
+	}
+	pthread_mutex_unlock(&watcher->mutex);
+
+	if (changed)
+		__atomic_fetch_add(&watcher->generation, 1, __ATOMIC_RELEASE);
+}
+
+static void *watcher_thread(void *user_data) {
+	FileWatcher *watcher = user_data;
+
+	// Aligned for struct inotify_event
+	uint64_t buffer[4096 / sizeof(uint64_t)];
+	struct pollfd fds[2] = {
+		{ .fd = watcher->inotify, .events = POLLIN },
+		{ .fd = watcher->wake[0], .events = POLLIN },
+	};
+
+	for (;;) {
+		if (poll(fds, 2, -1) == -1) {
+			if (errno == EINTR)
+				continue;
+			LOG_ERROR("FILE_WATCHER: poll failed: %s", strerror(errno));
+			break;
+		}
+		if (fds[1].revents)
+			break;
+
+		ssize_t length = read(watcher->inotify, buffer, sizeof(buffer));
+		if (length <= 0)
+			continue;
+
+		for (char *cursor = (char *)buffer; cursor < (char *)buffer + length;) {
+			const struct inotify_event *event = (const struct inotify_event *)cursor;
+			watcher_handle_event(watcher, event);
+			cursor += sizeof(struct inotify_event) + event->len;
+		}
+	}
+
+	return NULL;
+}
+
+FileWatcher *file_watcher_create(Arena *arena) {
+	int32_t descriptor = inotify_init1(IN_CLOEXEC);
+	if (descriptor == -1) {
+		LOG_WARN("FILE_WATCHER: inotify_init1 failed: %s", strerror(errno));
+		return NULL;
+	}
+
+	FileWatcher *watcher = arena_push_type_zero(arena, FileWatcher);
+	watcher->inotify = descriptor;
+	if (pipe(watcher->wake) == -1) {
+		LOG_WARN("FILE_WATCHER: pipe failed: %s", strerror(errno));
+		close(descriptor);
+		return NULL;
+	}
+
+	pthread_mutex_init(&watcher->mutex, NULL);
+	if (pthread_create(&watcher->thread, NULL, watcher_thread, watcher) != 0) {
+		LOG_WARN("FILE_WATCHER: Failed to start watcher thread");
+		pthread_mutex_destroy(&watcher->mutex);
+		close(watcher->wake[0]);
+		close(watcher->wake[1]);
+		close(descriptor);
+		return NULL;
+	}
+
+	return watcher;
+}
+
+void file_watcher_destroy(FileWatcher *watcher) {
+	if (watcher == NULL)
+		return;
+
+	char byte = 0;
+	if (write(watcher->wake[1], &byte, 1) == 1)
+		pthread_join(watcher->thread, NULL);
+
+	pthread_mutex_destroy(&watcher->mutex);
+	close(watcher->wake[0]);
+	close(watcher->wake[1]);
+	close(watcher->inotify);
+}
+
+static uint32_t watcher_directory(FileWatcher *watcher, const char *path) {
+	for (uint32_t i = 0; i < watcher->directory_count; i++) {
+		if (strcmp(watcher->directories[i].path, path) == 0)
+			return i;
+	}
+
+	if (watcher->directory_count == FILE_WATCHER_MAX_DIRECTORIES) {
+		LOG_WARN("FILE_WATCHER: More than %d directories watched", FILE_WATCHER_MAX_DIRECTORIES);
+		return FILE_WATCHER_INVALID;
+	}
+
+	int32_t descriptor = inotify_add_watch(watcher->inotify, path, FILE_WATCHER_EVENTS);
+	if (descriptor == -1) {
+		LOG_WARN("FILE_WATCHER: Cannot watch '%s': %s", path, strerror(errno));
+		return FILE_WATCHER_INVALID;
+	}
+
+	WatchedDirectory *directory = &watcher->directories[watcher->directory_count];
+	snprintf(directory->path, sizeof(directory->path), "%s", path);
+	directory->descriptor = descriptor;
+	return watcher->directory_count++;
+}
+
+uint32_t file_watcher_add(FileWatcher *watcher, const char *path) {
+	if (watcher == NULL)
+		return FILE_WATCHER_INVALID;
+
+	uint32_t id = FILE_WATCHER_INVALID;
+	pthread_mutex_lock(&watcher->mutex);
+
+	for (uint32_t i = 0; i < watcher->file_count; i++) {
+		if (strcmp(watcher->files[i].path, path) == 0) {
+			id = i;
+			goto done;
+		}
+	}
+
+	if (watcher->file_count == FILE_WATCHER_MAX_FILES || strlen(path) >= FILE_WATCHER_PATH_LENGTH) {
+		LOG_WARN("FILE_WATCHER: Cannot watch '%s'", path);
+		goto done;
+	}
+
+	WatchedFile *file = &watcher->files[watcher->file_count];
+	snprintf(file->path, sizeof(file->path), "%s", path);
+
+	char directory[FILE_WATCHER_PATH_LENGTH];
+	char *separator = strrchr(file->path, '/');
+	if (separator) {
+		snprintf(directory, sizeof(directory), "%.*s", (int)(separator - file->path), file->path);
+		file->name = separator + 1;
+	} else {
+		snprintf(directory, sizeof(directory), ".");
+		file->name = file->path;
+	}
+
+	file->directory = watcher_directory(watcher, directory);
+	if (file->directory != FILE_WATCHER_INVALID)
+		id = watcher->file_count++;
+
+done:
+	pthread_mutex_unlock(&watcher->mutex);
+	return id;
+}
+
+uint32_t file_watcher_generation(const FileWatcher *watcher) {
+	return watcher ? __atomic_load_n(&watcher->generation, __ATOMIC_ACQUIRE) : 0;
+}
+
+bool file_watcher_consume(FileWatcher *watcher, uint32_t id) {
+	if (watcher == NULL || id >= FILE_WATCHER_MAX_FILES)
+		return false;
+	return __atomic_exchange_n(&watcher->files[id].changed, 0, __ATOMIC_ACQUIRE) != 0;
+}
+
+#else
+
+FileWatcher *file_watcher_create(Arena *arena) {
+	LOG_WARN("FILE_WATCHER: Not supported on this platform");
+	return NULL;
+}
+void file_watcher_destroy(FileWatcher *watcher) {}
+
+uint32_t file_watcher_add(FileWatcher *watcher, const char *path) {
+	return FILE_WATCHER_INVALID;
+}
+
+uint32_t file_watcher_generation(const FileWatcher *watcher) {
+	return 0;
+}
+bool file_watcher_consume(FileWatcher *watcher, uint32_t id) {
+	return false;
+}
+
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct _arena Arena;
+typedef struct _file_watcher FileWatcher;
+
+#define FILE_WATCHER_INVALID UINT32_MAX
+#define FILE_WATCHER_MAX_FILES 64
+
+// Watches files from a background thread (inotify on Linux). Returns NULL where unsupported.
+FileWatcher *file_watcher_create(Arena *arena);
+void file_watcher_destroy(FileWatcher *watcher);
+
+// Returns an id for file_watcher_consume, adding the same path twice returns the same id
+uint32_t file_watcher_add(FileWatcher *watcher, const char *path);
+
+// Incremented after every change to a watched file, a single atomic load
+uint32_t file_watcher_generation(const FileWatcher *watcher);
+// Returns whether the file changed since the last call and clears the flag
+bool file_watcher_consume(FileWatcher *watcher, uint32_t id);
@@ -0,0 +1,101 @@
+#include "handle_pool.h"
+
+#include "arena.h"
+#include "logger.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define HANDLE_INDEX_MASK (HANDLE_POOL_MAX_CAPACITY - 1)
+
+typedef struct {
+	uint16_t generation;
+	bool live;
+	// Next free slot while this one is free
+	uint32_t next_free;
+} HandleSlot;
+
+struct _handle_pool {
+	HandleSlot *slots;
+	uint8_t *items;
+	size_t item_size;
+	uint32_t capacity, end, count;
+	uint32_t first_free;
+};
+
+HandlePool *handle_pool_create(Arena *arena, uint32_t capacity, size_t item_size) {
+	if (capacity == 0 || capacity > HANDLE_POOL_MAX_CAPACITY || item_size == 0) {
+		LOG_ERROR("handle_pool_create(): Invalid parameters");
+		return NULL;
+	}
+
+	HandlePool *pool = arena_push_type(arena, HandlePool);
+	*pool = (HandlePool){
+		.slots = arena_push_array_zero(arena, HandleSlot, capacity),
+		.items = arena_push_zero(arena, item_size * capacity),
+		.item_size = item_size,
+		.capacity = capacity,
+		.first_free = capacity,
+	};
+	return pool;
+}
+
+uint32_t handle_pool_alloc(HandlePool *pool) {
+	uint32_t index;
+	if (pool->first_free < pool->capacity) {
+		index = pool->first_free;
+		pool->first_free = pool->slots[index].next_free;
+	} else if (pool->end < pool->capacity) {
+		index = pool->end++;
+	} else {
+		return HANDLE_INVALID;
+	}
+
+	HandleSlot *slot = &pool->slots[index];
+	// Generation 0 would make the first slot's handle HANDLE_INVALID
+	if (slot->generation == 0)
+		slot->generation = 1;
+	slot->live = true;
+	pool->count++;
+
+	memset(pool->items + pool->item_size * index, 0, pool->item_size);
+	return ((uint32_t)slot->generation << HANDLE_INDEX_BITS) | index;
+}
+
+void handle_pool_free(HandlePool *pool, uint32_t handle) {
+	if (handle_pool_get(pool, handle) == NULL)
+		return;
+
+	uint32_t index = handle & HANDLE_INDEX_MASK;
+	HandleSlot *slot = &pool->slots[index];
+	slot->generation++;
+	slot->live = false;
+	slot->next_free = pool->first_free;
+	pool->first_free = index;
+	pool->count--;
+}
+
+void *handle_pool_get(const HandlePool *pool, uint32_t handle) {
+	uint32_t index = handle & HANDLE_INDEX_MASK;
+	if (index >= pool->end)
+		return NULL;
+
+	const HandleSlot *slot = &pool->slots[index];
+	if (!slot->live || slot->generation != handle >> HANDLE_INDEX_BITS)
+		return NULL;
+	return pool->items + pool->item_size * index;
+}
+
+uint32_t handle_pool_end(const HandlePool *pool) {
+	return pool->end;
+}
+
+uint32_t handle_pool_handle_at(const HandlePool *pool, uint32_t index) {
+	if (index >= pool->end || !pool->slots[index].live)
+		return HANDLE_INVALID;
+	return ((uint32_t)pool->slots[index].generation << HANDLE_INDEX_BITS) | index;
+}
+
+uint32_t handle_pool_count(const HandlePool *pool) {
+	return pool->count;
+}
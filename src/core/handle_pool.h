@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct _arena Arena;
+typedef struct _handle_pool HandlePool;
+
+// Never returned by handle_pool_alloc, so zeroed handles resolve to nothing
+#define HANDLE_INVALID 0
+#define HANDLE_INDEX_BITS 16
+#define HANDLE_POOL_MAX_CAPACITY (1u << HANDLE_INDEX_BITS)
+
+// Fixed array of items addressed by 32-bit handles: the low bits index the array, the high bits
+// are the generation of the slot. Freeing a slot bumps its generation, so old handles stop
+// resolving instead of reaching whatever reuses the slot. Items never move.
+HandlePool *handle_pool_create(Arena *arena, uint32_t capacity, size_t item_size);
+
+// Zeroes the item, HANDLE_INVALID when the pool is full
+uint32_t handle_pool_alloc(HandlePool *pool);
+void handle_pool_free(HandlePool *pool, uint32_t handle);
+// An index and a generation compare, NULL for stale handles
+void *handle_pool_get(const HandlePool *pool, uint32_t handle);
+
+// Slots below this were allocated at some point, for iterating with handle_pool_handle_at
+uint32_t handle_pool_end(const HandlePool *pool);
+// The live handle of the slot at index, HANDLE_INVALID when it is free
+uint32_t handle_pool_handle_at(const HandlePool *pool, uint32_t index);
+uint32_t handle_pool_count(const HandlePool *pool);
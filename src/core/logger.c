@@ -1,9 +1,16 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "logger.h"
 
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
 
+// Longer lines are cut short
+#define LOG_LINE_LENGTH 1024
+
 typedef struct {
 	va_list arguments;
 	const char *format;
@@ -36,20 +43,28 @@ void logger_set_quiet(bool enable) {
 	g_logger.quiet = enable;
 }
 
+// Called from the thread pool as well, so the line is formatted into one buffer and written at
+// once, which stdio keeps whole between threads
 void logger_log(LogLevel level, const char *file, int line, const char *format, ...) {
 	if (level < g_logger.level) {
 		return;
 	}
 
 	time_t t = time(NULL);
-	struct tm *tm_info = localtime(&t);
+	struct tm tm_info;
+#ifdef _WIN32
+	localtime_s(&tm_info, &t);
+#else
+	localtime_r(&t, &tm_info);
+#endif
 
 	char time_buffer[16];
-	strftime(time_buffer, sizeof(time_buffer), "%H:%M:%S", tm_info);
+	strftime(time_buffer, sizeof(time_buffer), "%H:%M:%S", &tm_info);
 
-	va_list arg_ptr;
-	va_start(arg_ptr, format);
-	printf(
+	// One byte is kept for the newline
+	char buffer[LOG_LINE_LENGTH];
+	size_t capacity = sizeof(buffer) - 1;
+	int length = snprintf(buffer, capacity,
 		"%s %s%-5s\x1b[0m \x1b[37m%s:%d:\x1b[0m ",
 		time_buffer, // Timestamp
 		g_log_level_colors[level], // Start color for the level
@@ -57,8 +72,16 @@ void logger_log(LogLevel level, const char *file, int line, const char *format,
 		file, // Source file name
 		line // Line number in source file
 	);
-	vprintf(format, arg_ptr);
-	printf("\n");
-	fflush(stdout);
+	size_t used = length < 0 ? 0 : ((size_t)length < capacity ? (size_t)length : capacity - 1);
+
+	va_list arg_ptr;
+	va_start(arg_ptr, format);
+	length = vsnprintf(buffer + used, capacity - used, format, arg_ptr);
 	va_end(arg_ptr);
+	if (length > 0)
+		used += (size_t)length < capacity - used ? (size_t)length : capacity - used - 1;
+
+	buffer[used++] = '\n';
+	fwrite(buffer, 1, used, stdout);
+	fflush(stdout);
 }
@@ -0,0 +1,140 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "thread_pool.h"
+
+#include "arena.h"
+#include "logger.h"
+
+#include <stdbool.h>
+
+#define THREAD_POOL_MAX_THREADS 8
+#define THREAD_POOL_QUEUE_SIZE 256
+
+typedef struct {
+	ThreadPoolJob job;
+	void *user_data;
+} ThreadPoolTask;
+
+#ifndef _WIN32
+
+#include <pthread.h>
+#include <unistd.h>
+
+struct _thread_pool {
+	pthread_t threads[THREAD_POOL_MAX_THREADS];
+	uint32_t thread_count;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t available;
+	ThreadPoolTask tasks[THREAD_POOL_QUEUE_SIZE];
+	uint32_t head, count;
+	bool stopping;
+};
+
+static void *thread_pool_worker(void *user_data) {
+	ThreadPool *pool = user_data;
+
+	for (;;) {
+		pthread_mutex_lock(&pool->mutex);
+		while (pool->count == 0 && !pool->stopping)
+			pthread_cond_wait(&pool->available, &pool->mutex);
+		if (pool->count == 0) {
+			pthread_mutex_unlock(&pool->mutex);
+			break;
+		}
+
+		ThreadPoolTask task = pool->tasks[pool->head];
+		pool->head = (pool->head + 1) % THREAD_POOL_QUEUE_SIZE;
+		pool->count--;
+		pthread_mutex_unlock(&pool->mutex);
+
+		task.job(task.user_data);
+	}
+
+	return NULL;
+}
+
+ThreadPool *thread_pool_create(Arena *arena, uint32_t thread_count) {
+	if (thread_count == 0) {
+		long core_count = sysconf(_SC_NPROCESSORS_ONLN);
+		thread_count = core_count > 1 ? (uint32_t)core_count - 1 : 1;
+	}
+	if (thread_count > THREAD_POOL_MAX_THREADS)
+		thread_count = THREAD_POOL_MAX_THREADS;
+
+	ThreadPool *pool = arena_push_type_zero(arena, ThreadPool);
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->available, NULL);
+
+	for (uint32_t i = 0; i < thread_count; i++) {
+		if (pthread_create(&pool->threads[i], NULL, thread_pool_worker, pool) != 0) {
+			LOG_WARN("THREAD_POOL: Failed to start thread %d", i);
+			break;
+		}
+		pool->thread_count++;
+	}
+
+	LOG_INFO("THREAD_POOL: Started %d threads", pool->thread_count);
+	return pool;
+}
+
+void thread_pool_destroy(ThreadPool *pool) {
+	if (pool == NULL)
+		return;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->stopping = true;
+	pthread_cond_broadcast(&pool->available);
+	pthread_mutex_unlock(&pool->mutex);
+
+	for (uint32_t i = 0; i < pool->thread_count; i++)
+		pthread_join(pool->threads[i], NULL);
+	pool->thread_count = 0;
+
+	pthread_cond_destroy(&pool->available);
+	pthread_mutex_destroy(&pool->mutex);
+}
+
+void thread_pool_submit(ThreadPool *pool, ThreadPoolJob job, void *user_data) {
+	pthread_mutex_lock(&pool->mutex);
+	if (pool->thread_count == 0 || pool->count == THREAD_POOL_QUEUE_SIZE) {
+		pthread_mutex_unlock(&pool->mutex);
+		job(user_data);
+		return;
+	}
+
+	pool->tasks[(pool->head + pool->count) % THREAD_POOL_QUEUE_SIZE] = (ThreadPoolTask){ job, user_data };
+	pool->count++;
+	pthread_cond_signal(&pool->available);
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+uint32_t thread_pool_thread_count(const ThreadPool *pool) {
+	return pool->thread_count;
+}
+
+#else
+
+struct _thread_pool {
+	uint32_t thread_count;
+};
+
+ThreadPool *thread_pool_create(Arena *arena, uint32_t thread_count) {
+	LOG_WARN("THREAD_POOL: Not supported on this platform, jobs run on the calling thread");
+	return arena_push_type_zero(arena, ThreadPool);
+}
+
+void thread_pool_destroy(ThreadPool *pool) {
+}
+
+void thread_pool_submit(ThreadPool *pool, ThreadPoolJob job, void *user_data) {
+	job(user_data);
+}
+
+uint32_t thread_pool_thread_count(const ThreadPool *pool) {
+	return 0;
+}
+
+#endif
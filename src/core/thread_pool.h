@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef struct _arena Arena;
+typedef struct _thread_pool ThreadPool;
+
+typedef void (*ThreadPoolJob)(void *user_data);
+
+// Runs jobs on background threads in submission order. A thread_count of 0 uses one thread per
+// core minus the main thread. Where threads are unsupported jobs run inside thread_pool_submit.
+ThreadPool *thread_pool_create(Arena *arena, uint32_t thread_count);
+// Finishes every queued job before joining the threads
+void thread_pool_destroy(ThreadPool *pool);
+
+// Runs the job on the calling thread when the queue is full
+void thread_pool_submit(ThreadPool *pool, ThreadPoolJob job, void *user_data);
+
+uint32_t thread_pool_thread_count(const ThreadPool *pool);
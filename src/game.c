@@ -1,22 +1,20 @@
 #include "game.h"
 
 #include "core/arena.h"
+#include "core/clock.h"
 #include "core/logger.h"
 
 #include "asset_manager.h"
 #include "renderer.h"
 #include "shader.h"
+#include "shader_cache.h"
 
 #include <cglm/cglm.h>
-#include <ctype.h>
 #include <glad/gl.h>
 
-#include <errno.h>
 #include <stdio.h>
 #include <string.h>
 
-#define MAX_LINE_LENGTH 512
-
 typedef enum {
 	GAME_STATE_NONE,
 	GAME_STATE_ACTIVE,
@@ -26,105 +24,161 @@ typedef enum {
 	GAME_STATE_COUNT
 } GameState;
 
+typedef enum {
+	SPRITE_SHADER_INSTANCED = 1 << 0,
+	SPRITE_SHADER_GRAYSCALE = 1 << 1,
+	SPRITE_SHADER_CHAOS = 1 << 2,
+	SPRITE_SHADER_SHAKE = 1 << 3,
+	SPRITE_SHADER_TEXTURE_ARRAY = 1 << 4,
+} SpriteShaderFeature;
+
+static const char *g_sprite_shader_features[] = { "INSTANCED", "GRAYSCALE", "CHAOS", "SHAKE", "TEXTURE_ARRAY" };
+
 static Arena *arena_permanent;
+// Cleared whenever the level is built again
+static Arena *arena_level;
 
 struct _game {
 	GameState state;
 	bool keys[1024];
 
 	uint32_t width, height;
+	mat4 projection;
+	uint64_t start_time;
+	LevelHandle level_asset;
+	uint32_t level_version;
 	Level *level;
+	InstanceLayer *bricks;
+	OpenGLShader *brick_shader;
+	TextureHandle sprite;
 
 	Renderer *renderer;
 };
 
-Game *game_create(uint32_t width, uint32_t height) {
+// The bricks copy the tiles and the sprite UVs, so they are built again whenever the level asset is
+static void game_build_level(Game *game) {
+	if (game->bricks)
+		renderer_destroy_instance_layer(game->bricks);
+	arena_clear(arena_level);
+
+	game->level_version = asset_manager_level_version(game->level_asset);
+	game->level = game_load_level(game->level_asset, game->sprite, game->width, game->height);
+	game->bricks = game->level ? renderer_create_instance_layer(game->renderer, arena_level, game->brick_shader, game->level->bricks, game->level->count) : NULL;
+}
+
+Game *game_create(uint32_t width, uint32_t height, RendererBackend backend) {
 	arena_permanent = arena_alloc();
+	arena_level = arena_alloc();
 	Game *game = arena_push_type(arena_permanent, Game);
 	*game = (Game){
 		.width = width,
 		.height = height,
 		.keys = { 0 },
-		.state = GAME_STATE_ACTIVE
+		.state = GAME_STATE_ACTIVE,
+		.start_time = clock_now_ns()
 	};
+	glm_ortho(0.0f, game->width, game->height, 0.0f, -1.0f, 1.0f, game->projection);
 
 	asset_manager_startup();
-	OpenGLShader *shader = asset_manager_load_shader("default", "assets/shaders/v_default.glsl", "assets/shaders/f_default.glsl");
-	asset_manager_load_texture("sprite", "./assets/sprites/player.png");
+	if (backend == RENDERER_BACKEND_SOFTWARE) {
+		opengl_texture_set_headless(true);
+		game->sprite = asset_manager_load_texture_async("sprite", "./assets/sprites/player.png", MIPMAP_FILTER_NONE);
+		asset_manager_wait_textures();
+
+		game->renderer = renderer_create_software(arena_permanent, game->width, game->height);
+		game->level_asset = asset_manager_load_level("level_01", "./assets/levels/level_01.csv", &game->sprite, 1);
+		game_build_level(game);
+		return game;
+	}
 
-	mat4 projection;
-	glm_mat4_identity(projection);
-	glm_ortho(0.0f, game->width, game->height, 0.0f, -1.0f, 1.0f, projection);
+	// Decode while the shaders build, the bricks copy the sprite UVs so it has to be ready first
+	game->sprite = asset_manager_load_texture_async("sprite", "./assets/sprites/player.png", MIPMAP_FILTER_NONE);
+	shader_cache_startup("shader_cache");
+	ShaderHandle sprite_shaders = asset_manager_load_shader_family("sprite", "assets/shaders/v_sprite.glsl", "assets/shaders/f_sprite.glsl",
+		g_sprite_shader_features, sizeof(g_sprite_shader_features) / sizeof(*g_sprite_shader_features));
+	uint32_t texture_features = opengl_texture_array_mode() ? SPRITE_SHADER_TEXTURE_ARRAY : 0;
+	OpenGLShader *shader = asset_manager_shader_variant(sprite_shaders, texture_features);
+	OpenGLShader *instanced_shader = asset_manager_shader_variant(sprite_shaders, SPRITE_SHADER_INSTANCED | texture_features);
+	asset_manager_wait_shaders();
+	shader_cache_log_stats();
+	asset_manager_wait_textures();
 
 	opengl_shader_activate(shader);
 	opengl_shader_seti(shader, "u_texture", 0);
-	opengl_shader_set4fm(shader, "u_projection", *projection);
+
+	opengl_shader_activate(instanced_shader);
+	opengl_shader_seti(instanced_shader, "u_texture", 0);
 
 	game->renderer = renderer_create(arena_permanent, shader);
-	game->level = game_load_level("./assets/levels/level_01.csv", game->width, game->height);
+	game->brick_shader = instanced_shader;
+	game->level_asset = asset_manager_load_level("level_01", "./assets/levels/level_01.csv", &game->sprite, 1);
+	game_build_level(game);
 
 	return game;
 }
 
+void game_destroy(Game *game) {
+	if (game->bricks)
+		renderer_destroy_instance_layer(game->bricks);
+	renderer_destroy(game->renderer);
+	asset_manager_release_level(game->level_asset);
+	asset_manager_release_texture(game->sprite);
+
+	arena_free(arena_level);
+	// The game itself lives in the permanent arena
+	arena_free(arena_permanent);
+	arena_level = arena_permanent = NULL;
+}
+
+Renderer *game_renderer(Game *game) {
+	return game->renderer;
+}
+
 void game_process_input(Game *game) {
 	(void)game;
 }
 
 void game_update(Game *game) {
-	(void)game;
+	if (asset_manager_level_version(game->level_asset) != game->level_version)
+		game_build_level(game);
 }
 
 void game_draw(Game *game) {
-	for (uint32_t i = 0; i < game->level->count; i++) {
-		Sprite sprite = game->level->bricks[i];
-		renderer_draw_sprite(game->renderer, sprite.texture, sprite.position, sprite.size, sprite.rotation, sprite.color);
-	}
-	renderer_draw_sprite(game->renderer, asset_manager_get_texture("sprite"), (vec2){ 100.0f, 100.0f }, (vec2){ 100.0f, 100.0f }, 0.0f, (vec3){ 1.0f, 1.0f, 1.0f });
-}
-
-Level *game_load_level(const char *path, uint32_t level_width, uint32_t level_height) {
-	Level *level = arena_push_type(arena_permanent, Level);
-
-	FILE *file;
-	if ((file = fopen(path, "r")) == NULL) {
-		LOG_ERROR("FILE: %s", strerror(errno));
-		return NULL;
-	}
+	float time = (float)((clock_now_ns() - game->start_time) / 1e9);
+	renderer_set_frame(game->renderer, game->projection, (vec2){ (float)game->width, (float)game->height }, time);
+	renderer_begin(game->renderer);
 
-	char buffer[MAX_LINE_LENGTH];
-	uint32_t max_file_line = 0, max_file_column = 0;
+	renderer_begin_pass(game->renderer, PROFILER_PASS_CLEAR);
+	renderer_clear(game->renderer, (vec4){ 1.0f, 1.0f, 1.0f, 1.0f });
+	renderer_end_pass(game->renderer, PROFILER_PASS_CLEAR);
 
-	for (; fgets(buffer, sizeof(buffer), file); max_file_line++) {
-		char *token = strtok(buffer, " \t\r\n");
+	renderer_begin_pass(game->renderer, PROFILER_PASS_BRICKS);
+	if (game->bricks)
+		renderer_draw_instance_layer(game->renderer, game->bricks);
+	renderer_end_pass(game->renderer, PROFILER_PASS_BRICKS);
 
-		for (uint32_t x = 0; token; x++) {
-			max_file_column = x == max_file_column ? x + 1 : max_file_column;
+	renderer_begin_pass(game->renderer, PROFILER_PASS_SPRITES);
+	renderer_submit_sprite(game->renderer, asset_manager_texture(game->sprite), (vec2){ 100.0f, 100.0f }, (vec2){ 100.0f, 100.0f }, 0.0f, (vec3){ 1.0f, 1.0f, 1.0f });
+	renderer_end_pass(game->renderer, PROFILER_PASS_SPRITES);
 
-			LOG_INFO("Token [%d, %d]: %c", x, max_file_column, *token);
-			token = strtok(NULL, " \t\r\n");
-		}
-	}
+	renderer_begin_pass(game->renderer, PROFILER_PASS_UI);
+	renderer_end_pass(game->renderer, PROFILER_PASS_UI);
+}
 
-	rewind(file);
+Level *game_load_level(LevelHandle level_asset, TextureHandle brick_texture, uint32_t level_width, uint32_t level_height) {
+	const LevelTiles *tiles = asset_manager_level(level_asset);
+	if (tiles == NULL || tiles->columns == 0)
+		return NULL;
 
-	level->capacity = max_file_line * max_file_column;
+	Level *level = arena_push_type(arena_level, Level);
+	level->capacity = tiles->rows * tiles->columns;
 	level->count = 0;
-	level->bricks = arena_push_array(arena_permanent, Sprite, level->capacity);
-
-	for (uint32_t y = 0; fgets(buffer, sizeof(buffer), file); y++) {
-		char *token = strtok(buffer, " \t\r\n");
-
-		for (uint32_t x = 0; x < max_file_column; x++) {
-			uint32_t index = x + y * max_file_column;
-			if (token == NULL)
-				LOG_WARN("LEVEL: Token [%d, %d] missing", x, y);
-
-			else if (isdigit(*token) == 0)
-				LOG_WARN("LEVEL: Token [%d, %d] missing", x, y);
-
-			OpenGLTexture *texture = asset_manager_get_texture("sprite");
-			int grid_size = ((level_width / max_file_column) / 16) * 16;
+	level->bricks = arena_push_array(arena_level, Sprite, level->capacity);
 
+	TextureRegion *texture = asset_manager_texture(brick_texture);
+	int grid_size = ((level_width / tiles->columns) / 16) * 16;
+	for (uint32_t y = 0; y < tiles->rows; y++) {
+		for (uint32_t x = 0; x < tiles->columns; x++) {
 			level->bricks[level->count++] = (Sprite){
 				.texture = texture,
 				.color = { 1.0f, 1.0f, 1.0f },
@@ -133,12 +187,8 @@ Level *game_load_level(const char *path, uint32_t level_width, uint32_t level_he
 				.rotation = 0.0f,
 
 			};
-
-			token = strtok(NULL, " \t\r\n");
 		}
 	}
 
-	fclose(file);
-
 	return level;
 }
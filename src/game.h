@@ -1,5 +1,7 @@
 #pragma once
 
+#include "asset_manager.h"
+#include "renderer.h"
 #include "types.h"
 
 #include <stdbool.h>
@@ -7,10 +9,13 @@
 
 typedef struct _game Game;
 
-Game *game_create(uint32_t width, uint32_t height);
+Game *game_create(uint32_t width, uint32_t height, RendererBackend backend);
+// Releases the game's assets and renderer, call before asset_manager_shutdown
+void game_destroy(Game *game);
+Renderer *game_renderer(Game *game);
 
 void game_process_input(Game *game);
 void game_update(Game *game);
 void game_draw(Game *game);
 
-Level *game_load_level(const char *path, uint32_t level_width, uint32_t level_height);
+Level *game_load_level(LevelHandle level, TextureHandle brick_texture, uint32_t level_width, uint32_t level_height);
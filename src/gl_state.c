@@ -0,0 +1,133 @@
+#include "gl_state.h"
+
+#include <glad/gl.h>
+
+#define GL_STATE_TEXTURE_UNITS 32
+// Sentinel that never matches a real object name, so the first call always goes through
+#define GL_STATE_UNKNOWN UINT32_MAX
+
+typedef struct {
+	uint32_t program;
+	uint32_t textures[GL_STATE_TEXTURE_UNITS];
+	uint32_t vertex_array;
+
+	uint32_t blend_enabled, blend_source, blend_destination;
+	int32_t viewport[4];
+	bool viewport_known;
+
+	OpenGLStateStats stats;
+} OpenGLState;
+
+static OpenGLState g_state;
+static bool g_state_initialized = false;
+
+static bool state_changed(bool changed) {
+	if (changed)
+		g_state.stats.issued++;
+	else
+		g_state.stats.avoided++;
+	return changed;
+}
+
+void opengl_state_reset(void) {
+	OpenGLStateStats stats = g_state.stats;
+
+	g_state.program = GL_STATE_UNKNOWN;
+	for (uint32_t i = 0; i < GL_STATE_TEXTURE_UNITS; i++)
+		g_state.textures[i] = GL_STATE_UNKNOWN;
+	g_state.vertex_array = GL_STATE_UNKNOWN;
+	g_state.blend_enabled = g_state.blend_source = g_state.blend_destination = GL_STATE_UNKNOWN;
+	g_state.viewport_known = false;
+
+	g_state.stats = stats;
+	g_state_initialized = true;
+}
+
+void opengl_state_begin_frame(void) {
+	g_state.stats = (OpenGLStateStats){ 0 };
+}
+
+OpenGLStateStats opengl_state_stats(void) {
+	return g_state.stats;
+}
+
+static void state_ensure_initialized(void) {
+	if (!g_state_initialized)
+		opengl_state_reset();
+}
+
+void opengl_state_use_program(uint32_t program) {
+	state_ensure_initialized();
+	if (state_changed(g_state.program != program)) {
+		glUseProgram(program);
+		g_state.program = program;
+	}
+}
+
+void opengl_state_bind_texture_unit(uint32_t unit, uint32_t texture) {
+	state_ensure_initialized();
+	if (unit >= GL_STATE_TEXTURE_UNITS) {
+		glBindTextureUnit(unit, texture);
+		g_state.stats.issued++;
+		return;
+	}
+	if (state_changed(g_state.textures[unit] != texture)) {
+		glBindTextureUnit(unit, texture);
+		g_state.textures[unit] = texture;
+	}
+}
+
+void opengl_state_bind_vertex_array(uint32_t vertex_array) {
+	state_ensure_initialized();
+	if (state_changed(g_state.vertex_array != vertex_array)) {
+		glBindVertexArray(vertex_array);
+		g_state.vertex_array = vertex_array;
+	}
+}
+
+void opengl_state_set_blend(bool enabled, uint32_t source_factor, uint32_t destination_factor) {
+	state_ensure_initialized();
+	if (state_changed(g_state.blend_enabled != (uint32_t)enabled)) {
+		if (enabled)
+			glEnable(GL_BLEND);
+		else
+			glDisable(GL_BLEND);
+		g_state.blend_enabled = enabled;
+	}
+
+	if (enabled && state_changed(g_state.blend_source != source_factor || g_state.blend_destination != destination_factor)) {
+		glBlendFunc(source_factor, destination_factor);
+		g_state.blend_source = source_factor;
+		g_state.blend_destination = destination_factor;
+	}
+}
+
+void opengl_state_set_viewport(int32_t x, int32_t y, int32_t width, int32_t height) {
+	state_ensure_initialized();
+	bool changed = !g_state.viewport_known || g_state.viewport[0] != x || g_state.viewport[1] != y || g_state.viewport[2] != width || g_state.viewport[3] != height;
+	if (state_changed(changed)) {
+		glViewport(x, y, width, height);
+		g_state.viewport[0] = x;
+		g_state.viewport[1] = y;
+		g_state.viewport[2] = width;
+		g_state.viewport[3] = height;
+		g_state.viewport_known = true;
+	}
+}
+
+void opengl_state_forget_program(uint32_t program) {
+	if (g_state.program == program)
+		g_state.program = GL_STATE_UNKNOWN;
+}
+
+void opengl_state_forget_texture(uint32_t texture) {
+	for (uint32_t i = 0; i < GL_STATE_TEXTURE_UNITS; i++) {
+		if (g_state.textures[i] == texture)
+			g_state.textures[i] = GL_STATE_UNKNOWN;
+	}
+}
+
+void opengl_state_forget_vertex_array(uint32_t vertex_array) {
+	if (g_state.vertex_array == vertex_array)
+		g_state.vertex_array = GL_STATE_UNKNOWN;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+	uint32_t issued, avoided;
+} OpenGLStateStats;
+
+// Forget everything cached, e.g. after a new context is made current or GL was called directly
+void opengl_state_reset(void);
+// Starts a new frame for the issued/avoided counters
+void opengl_state_begin_frame(void);
+OpenGLStateStats opengl_state_stats(void);
+
+void opengl_state_use_program(uint32_t program);
+void opengl_state_bind_texture_unit(uint32_t unit, uint32_t texture);
+void opengl_state_bind_vertex_array(uint32_t vertex_array);
+void opengl_state_set_blend(bool enabled, uint32_t source_factor, uint32_t destination_factor);
+void opengl_state_set_viewport(int32_t x, int32_t y, int32_t width, int32_t height);
+
+// Drop cached bindings of an object that is about to be deleted so a recycled name is rebound
+void opengl_state_forget_program(uint32_t program);
+void opengl_state_forget_texture(uint32_t texture);
+void opengl_state_forget_vertex_array(uint32_t vertex_array);
@@ -0,0 +1,271 @@
+#include "ktx2.h"
+
+#include "core/logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KTX2_HEADER_SIZE 80
+#define KTX2_LEVEL_INDEX_SIZE 24
+
+static const uint8_t g_ktx2_identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+// VkFormat values of the supported formats, linear then sRGB
+static const struct {
+	Ktx2Format format;
+	uint32_t vk_format[2];
+	// Data format descriptor color model, see the Khronos Data Format Specification
+	uint32_t color_model;
+	uint32_t block_size;
+} g_ktx2_formats[] = {
+	{ KTX2_FORMAT_RGBA8, { 37, 43 }, 1, 4 },
+	{ KTX2_FORMAT_BC1, { 133, 134 }, 128, 8 },
+	{ KTX2_FORMAT_BC3, { 137, 138 }, 130, 16 },
+	{ KTX2_FORMAT_BC7, { 145, 146 }, 135, 16 },
+};
+
+#define KTX2_FORMAT_COUNT (sizeof(g_ktx2_formats) / sizeof(*g_ktx2_formats))
+
+static uint32_t read_u32(const uint8_t *bytes) {
+	return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+static uint64_t read_u64(const uint8_t *bytes) {
+	return (uint64_t)read_u32(bytes) | (uint64_t)read_u32(bytes + 4) << 32;
+}
+
+static void write_u32(uint8_t *bytes, uint32_t value) {
+	for (uint32_t i = 0; i < 4; i++)
+		bytes[i] = (uint8_t)(value >> (8 * i));
+}
+
+static void write_u64(uint8_t *bytes, uint64_t value) {
+	write_u32(bytes, (uint32_t)value);
+	write_u32(bytes + 4, (uint32_t)(value >> 32));
+}
+
+static uint32_t ktx2_format_index(Ktx2Format format) {
+	for (uint32_t i = 0; i < KTX2_FORMAT_COUNT; i++) {
+		if (g_ktx2_formats[i].format == format)
+			return i;
+	}
+	return UINT32_MAX;
+}
+
+size_t ktx2_level_size(Ktx2Format format, uint32_t width, uint32_t height) {
+	uint32_t index = ktx2_format_index(format);
+	if (index == UINT32_MAX)
+		return 0;
+	if (format == KTX2_FORMAT_RGBA8)
+		return (size_t)width * height * 4;
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * g_ktx2_formats[index].block_size;
+}
+
+const char *ktx2_format_name(Ktx2Format format) {
+	switch (format) {
+		case KTX2_FORMAT_RGBA8: return "RGBA8";
+		case KTX2_FORMAT_BC1: return "BC1";
+		case KTX2_FORMAT_BC3: return "BC3";
+		case KTX2_FORMAT_BC7: return "BC7";
+		default: return "unknown";
+	}
+}
+
+static uint32_t level_dimension(uint32_t size, uint32_t level) {
+	return size >> level ? size >> level : 1;
+}
+
+bool ktx2_parse(const char *name, const uint8_t *bytes, size_t size, Ktx2Image *image) {
+	*image = (Ktx2Image){ 0 };
+	if (size <= KTX2_HEADER_SIZE || memcmp(bytes, g_ktx2_identifier, sizeof(g_ktx2_identifier)) != 0) {
+		LOG_ERROR("KTX2: %s is not a KTX2 file", name);
+		return false;
+	}
+
+	uint32_t vk_format = read_u32(bytes + 12);
+	uint32_t width = read_u32(bytes + 20), height = read_u32(bytes + 24), depth = read_u32(bytes + 28);
+	uint32_t layer_count = read_u32(bytes + 32), face_count = read_u32(bytes + 36);
+	uint32_t level_count = read_u32(bytes + 40), supercompression = read_u32(bytes + 44);
+	if (level_count == 0)
+		level_count = 1;
+
+	image->width = width;
+	image->height = height;
+	image->level_count = level_count;
+	for (uint32_t i = 0; i < KTX2_FORMAT_COUNT; i++) {
+		for (uint32_t srgb = 0; srgb < 2; srgb++) {
+			if (g_ktx2_formats[i].vk_format[srgb] == vk_format) {
+				image->format = g_ktx2_formats[i].format;
+				image->srgb = srgb;
+			}
+		}
+	}
+
+	if (image->format == KTX2_FORMAT_UNKNOWN || width == 0 || height == 0 || depth > 1 || layer_count > 1 || face_count != 1 ||
+		level_count > KTX2_MAX_LEVELS || supercompression != 0 || KTX2_HEADER_SIZE + (size_t)level_count * KTX2_LEVEL_INDEX_SIZE > size) {
+		LOG_ERROR("KTX2: %s uses an unsupported layout (VkFormat %u, %u levels, supercompression %u)", name, vk_format, level_count, supercompression);
+		*image = (Ktx2Image){ 0 };
+		return false;
+	}
+
+	for (uint32_t level = 0; level < level_count; level++) {
+		const uint8_t *entry = bytes + KTX2_HEADER_SIZE + level * KTX2_LEVEL_INDEX_SIZE;
+		uint64_t offset = read_u64(entry), length = read_u64(entry + 8);
+		size_t expected = ktx2_level_size(image->format, level_dimension(width, level), level_dimension(height, level));
+		if (offset > size || length > size - offset || length != expected) {
+			LOG_ERROR("KTX2: %s level %u is truncated", name, level);
+			*image = (Ktx2Image){ 0 };
+			return false;
+		}
+		image->levels[level] = (Ktx2Level){ bytes + offset, (size_t)length };
+	}
+
+	return true;
+}
+
+bool ktx2_read(const char *path, Ktx2Image *image) {
+	*image = (Ktx2Image){ 0 };
+
+	FILE *file = fopen(path, "rb");
+	if (file == NULL)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	long file_size = ftell(file);
+	rewind(file);
+
+	uint8_t *bytes = file_size > KTX2_HEADER_SIZE ? malloc(file_size) : NULL;
+	size_t size = bytes ? fread(bytes, 1, file_size, file) : 0;
+	fclose(file);
+	if (bytes == NULL || size != (size_t)file_size) {
+		LOG_ERROR("KTX2: %s is not a KTX2 file", path);
+		free(bytes);
+		return false;
+	}
+	if (!ktx2_parse(path, bytes, size, image)) {
+		free(bytes);
+		return false;
+	}
+
+	image->storage = bytes;
+	return true;
+}
+
+void ktx2_release(Ktx2Image *image) {
+	free(image->storage);
+	*image = (Ktx2Image){ 0 };
+}
+
+typedef struct {
+	uint32_t channel, bit_offset, bit_length;
+} Ktx2Sample;
+
+static const Ktx2Sample g_rgba8_samples[] = { { 0, 0, 8 }, { 1, 8, 8 }, { 2, 16, 8 }, { 15, 24, 8 } };
+static const Ktx2Sample g_bc1_samples[] = { { 1, 0, 64 } };
+static const Ktx2Sample g_bc3_samples[] = { { 15, 0, 64 }, { 0, 64, 64 } };
+static const Ktx2Sample g_bc7_samples[] = { { 0, 0, 128 } };
+
+// Basic data format descriptor, a single block describing the channels of a texel block
+static size_t ktx2_write_dfd(uint8_t *dfd, const Ktx2Image *image, uint32_t format_index) {
+	const Ktx2Sample *samples = g_rgba8_samples;
+	uint32_t sample_count = 4;
+	switch (image->format) {
+		case KTX2_FORMAT_BC1: {
+			samples = g_bc1_samples;
+			sample_count = 1;
+		} break;
+		case KTX2_FORMAT_BC3: {
+			samples = g_bc3_samples;
+			sample_count = 2;
+		} break;
+		case KTX2_FORMAT_BC7: {
+			samples = g_bc7_samples;
+			sample_count = 1;
+		} break;
+		default: break;
+	}
+
+	bool compressed = image->format != KTX2_FORMAT_RGBA8;
+	uint32_t block_size = 24 + 16 * sample_count;
+	write_u32(dfd, 4 + block_size);
+	write_u32(dfd + 4, 0);
+	write_u32(dfd + 8, 2 | block_size << 16);
+	// Color model, BT.709 primaries, linear or sRGB transfer, straight alpha
+	write_u32(dfd + 12, g_ktx2_formats[format_index].color_model | 1 << 8 | (image->srgb ? 2 : 1) << 16);
+	write_u32(dfd + 16, compressed ? 3 | 3 << 8 : 0);
+	write_u32(dfd + 20, g_ktx2_formats[format_index].block_size);
+	write_u32(dfd + 24, 0);
+
+	for (uint32_t i = 0; i < sample_count; i++) {
+		uint32_t channel = samples[i].channel;
+		// Alpha stays linear in sRGB formats
+		if (image->srgb && channel == 15 && !compressed)
+			channel |= 0x10;
+
+		uint8_t *entry = dfd + 28 + 16 * i;
+		write_u32(entry, samples[i].bit_offset | (samples[i].bit_length - 1) << 16 | channel << 24);
+		write_u32(entry + 4, 0);
+		write_u32(entry + 8, 0);
+		write_u32(entry + 12, compressed ? UINT32_MAX : 255);
+	}
+
+	return 4 + block_size;
+}
+
+bool ktx2_write(const char *path, const Ktx2Image *image) {
+	uint32_t format_index = ktx2_format_index(image->format);
+	if (format_index == UINT32_MAX || image->level_count == 0 || image->level_count > KTX2_MAX_LEVELS) {
+		LOG_ERROR("KTX2: Cannot write %s image with %u levels", ktx2_format_name(image->format), image->level_count);
+		return false;
+	}
+
+	uint8_t header[KTX2_HEADER_SIZE + KTX2_MAX_LEVELS * KTX2_LEVEL_INDEX_SIZE + 128] = { 0 };
+	size_t dfd_offset = KTX2_HEADER_SIZE + image->level_count * KTX2_LEVEL_INDEX_SIZE;
+	size_t dfd_size = ktx2_write_dfd(header + dfd_offset, image, format_index);
+
+	memcpy(header, g_ktx2_identifier, sizeof(g_ktx2_identifier));
+	write_u32(header + 12, g_ktx2_formats[format_index].vk_format[image->srgb]);
+	write_u32(header + 16, 1);
+	write_u32(header + 20, image->width);
+	write_u32(header + 24, image->height);
+	write_u32(header + 36, 1);
+	write_u32(header + 40, image->level_count);
+	write_u32(header + 48, (uint32_t)dfd_offset);
+	write_u32(header + 52, (uint32_t)dfd_size);
+
+	// Levels are stored smallest first, each aligned to the block size
+	size_t alignment = g_ktx2_formats[format_index].block_size;
+	size_t offsets[KTX2_MAX_LEVELS];
+	size_t end = dfd_offset + dfd_size;
+	for (uint32_t level = image->level_count; level-- > 0;) {
+		end = (end + alignment - 1) / alignment * alignment;
+		offsets[level] = end;
+		end += image->levels[level].size;
+
+		uint8_t *entry = header + KTX2_HEADER_SIZE + level * KTX2_LEVEL_INDEX_SIZE;
+		write_u64(entry, offsets[level]);
+		write_u64(entry + 8, image->levels[level].size);
+		write_u64(entry + 16, image->levels[level].size);
+	}
+
+	FILE *file = fopen(path, "wb");
+	if (file == NULL) {
+		LOG_ERROR("KTX2: Failed to open %s for writing", path);
+		return false;
+	}
+
+	static const uint8_t zeros[16] = { 0 };
+	bool success = fwrite(header, 1, dfd_offset + dfd_size, file) == dfd_offset + dfd_size;
+	size_t written = dfd_offset + dfd_size;
+	for (uint32_t level = image->level_count; success && level-- > 0;) {
+		success = fwrite(zeros, 1, offsets[level] - written, file) == offsets[level] - written &&
+			fwrite(image->levels[level].data, 1, image->levels[level].size, file) == image->levels[level].size;
+		written = offsets[level] + image->levels[level].size;
+	}
+	success = fclose(file) == 0 && success;
+
+	if (!success)
+		LOG_ERROR("KTX2: Failed to write %s", path);
+	return success;
+}
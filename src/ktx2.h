@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define KTX2_MAX_LEVELS 16
+
+typedef enum {
+	KTX2_FORMAT_UNKNOWN,
+	KTX2_FORMAT_RGBA8,
+	KTX2_FORMAT_BC1,
+	KTX2_FORMAT_BC3,
+	KTX2_FORMAT_BC7,
+} Ktx2Format;
+
+typedef struct {
+	const uint8_t *data;
+	size_t size;
+} Ktx2Level;
+
+// A 2D texture and its mip chain, levels[0] is the full size image
+typedef struct _ktx2_image Ktx2Image;
+struct _ktx2_image {
+	Ktx2Format format;
+	bool srgb;
+	uint32_t width, height;
+	Ktx2Level levels[KTX2_MAX_LEVELS];
+	uint32_t level_count;
+	// The file contents the levels point into, owned by images from ktx2_read
+	uint8_t *storage;
+};
+
+// Only single 2D images without supercompression are supported. Returns false without logging
+// when the file does not exist, so callers can fall back to the source image.
+bool ktx2_read(const char *path, Ktx2Image *image);
+// Parses a file already in memory, the levels point into bytes and the image owns nothing.
+// name is only used in log messages.
+bool ktx2_parse(const char *name, const uint8_t *bytes, size_t size, Ktx2Image *image);
+void ktx2_release(Ktx2Image *image);
+bool ktx2_write(const char *path, const Ktx2Image *image);
+
+// Bytes of a width x height level, block compressed formats round up to whole 4x4 blocks
+size_t ktx2_level_size(Ktx2Format format, uint32_t width, uint32_t height);
+const char *ktx2_format_name(Ktx2Format format);
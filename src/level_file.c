@@ -0,0 +1,68 @@
+#include "level_file.h"
+
+#include "core/logger.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Returns the next whitespace separated token in [*cursor, end) and moves the cursor past it,
+// NULL when the line has no tokens left
+static const char *next_token(const char **cursor, const char *end) {
+	const char *token = *cursor;
+	while (token < end && isspace((unsigned char)*token))
+		token++;
+	const char *token_end = token;
+	while (token_end < end && !isspace((unsigned char)*token_end))
+		token_end++;
+	*cursor = token_end;
+	return token < end ? token : NULL;
+}
+
+static const char *line_end(const char *line, const char *end) {
+	const char *newline = memchr(line, '\n', end - line);
+	return newline ? newline : end;
+}
+
+bool level_file_parse_csv(const char *name, const char *text, size_t size, LevelTiles *level) {
+	*level = (LevelTiles){ 0 };
+	const char *end = text + size;
+
+	// The widest row sets the column count, so the grid is sized before it is filled
+	for (const char *line = text; line < end; level->rows++) {
+		const char *cursor = line, *row_end = line_end(line, end);
+		for (uint32_t x = 0; next_token(&cursor, row_end); x++)
+			level->columns = x + 1 > level->columns ? x + 1 : level->columns;
+		line = row_end + 1;
+	}
+	if (level->columns == 0) {
+		LOG_ERROR("LEVEL: %s has no tiles", name);
+		return false;
+	}
+
+	level->owned = malloc((size_t)level->rows * level->columns);
+	if (level->owned == NULL)
+		return false;
+	level->tiles = level->owned;
+
+	uint32_t y = 0;
+	for (const char *line = text; line < end; y++) {
+		const char *cursor = line, *row_end = line_end(line, end);
+		for (uint32_t x = 0; x < level->columns; x++) {
+			const char *token = next_token(&cursor, row_end);
+			uint32_t tile = 0;
+			if (token == NULL || isdigit((unsigned char)*token) == 0)
+				LOG_WARN("LEVEL: %s: Token [%d, %d] missing", name, x, y);
+			else
+				tile = (uint32_t)strtoul(token, NULL, 10);
+			level->owned[(size_t)y * level->columns + x] = (uint8_t)(tile < UINT8_MAX ? tile : UINT8_MAX);
+		}
+		line = row_end + 1;
+	}
+	return true;
+}
+
+void level_file_release(LevelTiles *level) {
+	free(level->owned);
+	*level = (LevelTiles){ 0 };
+}
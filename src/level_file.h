@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A level as a grid of tile values, row by row. The cooked form is the grid itself.
+typedef struct {
+	uint32_t columns, rows;
+	const uint8_t *tiles;
+	// Parsed tiles to free, NULL when tiles point into the archive
+	uint8_t *owned;
+} LevelTiles;
+
+// Parses a level .csv, one row per line with whitespace separated digits. Short rows and cells
+// that are not numbers become 0 with a warning. name is only used in log messages.
+bool level_file_parse_csv(const char *name, const char *text, size_t size, LevelTiles *level);
+void level_file_release(LevelTiles *level);
@@ -4,8 +4,11 @@
 
 #include "asset_manager.h"
 #include "game.h"
+#include "gl_state.h"
+#include "profiler.h"
 #include "shader.h"
 #include "texture.h"
+#include "texture_residency.h"
 
 #define GLAD_GL_IMPLEMENTATION
 #include <glad/gl.h>
@@ -17,6 +20,7 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 const uint32_t SCREEN_WIDTH = 640, SCREEN_HEIGHT = 480;
 
@@ -25,41 +29,151 @@ typedef struct _display {
 	uint32_t width, height;
 } Display;
 
+typedef struct {
+	bool headless;
+	uint32_t frame_count;
+	const char *dump_directory;
+	SoftwareFilter filter;
+	// Megabytes, 0 keeps the default
+	uint32_t texture_budget;
+	bool texture_array;
+	bool loose_assets;
+} Options;
+
 void initialize_display(Display *display);
 void gl_message_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, GLchar const *message, void const *user_param);
 
+static Options parse_options(int argc, char **argv);
+static int run_headless(const Options *options);
+
+int main(int argc, char **argv) {
+	Options options = parse_options(argc, argv);
+	if (options.loose_assets)
+		asset_manager_set_archive(NULL);
+	if (options.headless)
+		return run_headless(&options);
 
-int main(void) {
 	Display display = {
 		.width = SCREEN_WIDTH,
 		.height = SCREEN_HEIGHT
 	};
 	initialize_display(&display);
-	Game *game = game_create(SCREEN_WIDTH, SCREEN_HEIGHT);
+	profiler_startup(true);
+	opengl_texture_set_array_mode(options.texture_array);
+	Game *game = game_create(SCREEN_WIDTH, SCREEN_HEIGHT, RENDERER_BACKEND_OPENGL);
+	if (options.texture_budget)
+		texture_residency_set_budget((size_t)options.texture_budget * 1024 * 1024);
 
-	while (!glfwWindowShouldClose(display.window)) {
+	for (uint32_t frame = 0; !glfwWindowShouldClose(display.window); frame++) {
 		int width, height;
 		glfwGetFramebufferSize(display.window, &width, &height);
+		opengl_state_begin_frame();
+		profiler_begin_frame();
 
+		asset_manager_update();
 		game_process_input(game);
+		profiler_cpu_begin(PROFILER_CPU_UPDATE);
 		game_update(game);
+		profiler_cpu_end(PROFILER_CPU_UPDATE);
 
-		glViewport(0, 0, width, height);
-		glClearColor(255, 255, 255, 255);
-		glClear(GL_COLOR_BUFFER_BIT);
+		opengl_state_set_viewport(0, 0, width, height);
 
+		profiler_cpu_begin(PROFILER_CPU_DRAW);
 		game_draw(game);
+		profiler_cpu_end(PROFILER_CPU_DRAW);
+
+		if (options.dump_directory) {
+			char path[512];
+			snprintf(path, sizeof(path), "%s/frame_%05u.ppm", options.dump_directory, frame);
+			if (!renderer_dump_frame(game_renderer(game), width, height, path))
+				LOG_ERROR("Failed to write frame to %s", path);
+		}
+		if (options.frame_count && frame + 1 >= options.frame_count)
+			glfwSetWindowShouldClose(display.window, GLFW_TRUE);
 
 		glfwSwapBuffers(display.window);
 		glfwPollEvents();
 	}
 
+	profiler_log_summary();
+	texture_residency_log_stats();
+	game_destroy(game);
+	profiler_shutdown();
+	asset_manager_shutdown();
+
 	glfwDestroyWindow(display.window);
 
 	glfwTerminate();
 	exit(EXIT_SUCCESS);
 }
 
+static Options parse_options(int argc, char **argv) {
+	Options options = { 0 };
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--headless") == 0)
+			options.headless = true;
+		else if (strcmp(argv[i], "--bilinear") == 0)
+			options.filter = SOFTWARE_FILTER_BILINEAR;
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			options.frame_count = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc)
+			options.dump_directory = argv[++i];
+		else if (strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc)
+			options.texture_budget = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--texture-array") == 0)
+			options.texture_array = true;
+		else if (strcmp(argv[i], "--loose-assets") == 0)
+			options.loose_assets = true;
+		else
+			LOG_WARN("Unknown option %s, usage: breakout [--headless] [--bilinear] [--frames N] [--dump DIRECTORY] [--texture-budget MB] [--texture-array] [--loose-assets]", argv[i]);
+	}
+	return options;
+}
+
+// Runs the game on the software renderer without creating a window or loading GL
+static int run_headless(const Options *options) {
+	profiler_startup(false);
+	Game *game = game_create(SCREEN_WIDTH, SCREEN_HEIGHT, RENDERER_BACKEND_SOFTWARE);
+	renderer_set_software_filter(game_renderer(game), options->filter);
+	if (options->texture_budget)
+		texture_residency_set_budget((size_t)options->texture_budget * 1024 * 1024);
+
+	int status = EXIT_SUCCESS;
+	uint32_t frame_count = options->frame_count ? options->frame_count : 1;
+	for (uint32_t frame = 0; frame < frame_count; frame++) {
+		profiler_begin_frame();
+
+		asset_manager_update();
+		game_process_input(game);
+		profiler_cpu_begin(PROFILER_CPU_UPDATE);
+		game_update(game);
+		profiler_cpu_end(PROFILER_CPU_UPDATE);
+
+		profiler_cpu_begin(PROFILER_CPU_DRAW);
+		game_draw(game);
+		profiler_cpu_end(PROFILER_CPU_DRAW);
+
+		if (options->dump_directory) {
+			char path[512];
+			snprintf(path, sizeof(path), "%s/frame_%05u.ppm", options->dump_directory, frame);
+			if (!renderer_dump_frame(game_renderer(game), SCREEN_WIDTH, SCREEN_HEIGHT, path)) {
+				LOG_ERROR("Failed to write frame to %s", path);
+				status = EXIT_FAILURE;
+				break;
+			}
+		}
+	}
+
+	if (status == EXIT_SUCCESS) {
+		profiler_log_summary();
+		texture_residency_log_stats();
+	}
+	game_destroy(game);
+	profiler_shutdown();
+	asset_manager_shutdown();
+	return status;
+}
+
 void gl_message_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei size, GLchar const *message, void const *user_param) {
 	(void)user_param, (void)size;
 
@@ -152,8 +266,8 @@ void initialize_display(Display *display) {
 	glfwMakeContextCurrent(display->window);
 	gladLoadGL(glfwGetProcAddress);
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	opengl_state_reset();
+	opengl_state_set_blend(true, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glEnable(GL_DEBUG_OUTPUT);
 
 	glDebugMessageCallback(gl_message_callback, NULL);
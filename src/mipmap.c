@@ -0,0 +1,379 @@
+#include "mipmap.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIPMAP_SSE2
+#endif
+
+#define MIPMAP_KAISER_TAPS 8
+#define MIPMAP_KAISER_BETA 4.0
+#define MIPMAP_ENCODE_TABLE_SIZE 16384
+
+// One RGBA texel per vector, the kernels below are written once against these
+#ifdef MIPMAP_SSE2
+typedef __m128 Texel;
+
+static inline Texel texel_load(const float *texel) { return _mm_loadu_ps(texel); }
+static inline void texel_store(float *texel, Texel value) { _mm_storeu_ps(texel, value); }
+static inline Texel texel_zero(void) { return _mm_setzero_ps(); }
+static inline Texel texel_add(Texel a, Texel b) { return _mm_add_ps(a, b); }
+static inline Texel texel_scale(Texel a, float scale) { return _mm_mul_ps(a, _mm_set1_ps(scale)); }
+static inline Texel texel_madd(Texel sum, Texel a, float weight) { return _mm_add_ps(sum, _mm_mul_ps(a, _mm_set1_ps(weight))); }
+
+// Ringing can push a premultiplied texel out of range, alpha goes back to [0, 1] and color to [0, alpha]
+static inline Texel texel_clamp(Texel a) {
+	Texel alpha = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3));
+	alpha = _mm_min_ps(_mm_max_ps(alpha, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+	return _mm_min_ps(_mm_max_ps(a, _mm_setzero_ps()), alpha);
+}
+#else
+typedef struct {
+	float v[4];
+} Texel;
+
+static inline Texel texel_load(const float *texel) {
+	Texel result;
+	memcpy(result.v, texel, sizeof(result.v));
+	return result;
+}
+
+static inline void texel_store(float *texel, Texel value) { memcpy(texel, value.v, sizeof(value.v)); }
+static inline Texel texel_zero(void) { return (Texel){ { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+
+static inline Texel texel_add(Texel a, Texel b) {
+	for (uint32_t c = 0; c < 4; c++)
+		a.v[c] += b.v[c];
+	return a;
+}
+
+static inline Texel texel_scale(Texel a, float scale) {
+	for (uint32_t c = 0; c < 4; c++)
+		a.v[c] *= scale;
+	return a;
+}
+
+static inline Texel texel_madd(Texel sum, Texel a, float weight) {
+	for (uint32_t c = 0; c < 4; c++)
+		sum.v[c] += a.v[c] * weight;
+	return sum;
+}
+
+static inline Texel texel_clamp(Texel a) {
+	float alpha = fminf(fmaxf(a.v[3], 0.0f), 1.0f);
+	for (uint32_t c = 0; c < 4; c++)
+		a.v[c] = fminf(fmaxf(a.v[c], 0.0f), alpha);
+	return a;
+}
+#endif
+
+typedef struct {
+	float to_linear[256];
+	uint8_t to_encoded[MIPMAP_ENCODE_TABLE_SIZE + 1];
+} MipmapTables;
+
+static float srgb_to_linear(float value) {
+	return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+// Built per call so workers never share them. Encoding walks the linear value of each rounding
+// threshold instead of evaluating the inverse curve for every table slot.
+static void mipmap_build_tables(bool srgb, MipmapTables *tables) {
+	for (uint32_t i = 0; i < 256; i++)
+		tables->to_linear[i] = srgb ? srgb_to_linear(i / 255.0f) : i / 255.0f;
+
+	uint32_t value = 0;
+	float threshold = srgb ? srgb_to_linear(0.5f / 255.0f) : 0.5f / 255.0f;
+	for (uint32_t i = 0; i <= MIPMAP_ENCODE_TABLE_SIZE; i++) {
+		float linear = (float)i / MIPMAP_ENCODE_TABLE_SIZE;
+		while (value < 255 && linear > threshold) {
+			value++;
+			threshold = srgb ? srgb_to_linear((value + 0.5f) / 255.0f) : (value + 0.5f) / 255.0f;
+		}
+		tables->to_encoded[i] = (uint8_t)value;
+	}
+}
+
+static void mipmap_decode(const MipmapTables *tables, const uint8_t *pixels, uint32_t channels, size_t count, float *texels) {
+	for (size_t i = 0; i < count; i++) {
+		const uint8_t *pixel = pixels + i * channels;
+		float *texel = texels + 4 * i;
+		float alpha = channels == 4 ? pixel[3] / 255.0f : channels == 2 ? pixel[1] / 255.0f : 1.0f;
+		if (channels >= 3) {
+			texel[0] = tables->to_linear[pixel[0]] * alpha;
+			texel[1] = tables->to_linear[pixel[1]] * alpha;
+			texel[2] = tables->to_linear[pixel[2]] * alpha;
+		} else {
+			texel[0] = texel[1] = texel[2] = tables->to_linear[pixel[0]] * alpha;
+		}
+		texel[3] = alpha;
+	}
+}
+
+static void mipmap_encode(const MipmapTables *tables, const float *texels, size_t count, uint8_t *pixels) {
+	size_t i = 0;
+#ifdef MIPMAP_SSE2
+	const __m128 scale = _mm_set1_ps((float)MIPMAP_ENCODE_TABLE_SIZE), epsilon = _mm_set1_ps(1e-8f);
+	for (; i < count; i++) {
+		__m128 texel = _mm_loadu_ps(texels + 4 * i);
+		__m128 alpha = _mm_shuffle_ps(texel, texel, _MM_SHUFFLE(3, 3, 3, 3));
+		__m128 color = _mm_div_ps(texel, _mm_max_ps(alpha, epsilon));
+		color = _mm_min_ps(_mm_max_ps(color, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		alpha = _mm_min_ps(_mm_max_ps(alpha, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+
+		int32_t index[4];
+		_mm_storeu_si128((__m128i *)index, _mm_cvtps_epi32(_mm_mul_ps(color, scale)));
+		pixels[4 * i + 0] = tables->to_encoded[index[0]];
+		pixels[4 * i + 1] = tables->to_encoded[index[1]];
+		pixels[4 * i + 2] = tables->to_encoded[index[2]];
+		pixels[4 * i + 3] = (uint8_t)(_mm_cvtss_f32(alpha) * 255.0f + 0.5f);
+	}
+#endif
+	for (; i < count; i++) {
+		const float *texel = texels + 4 * i;
+		float alpha = fminf(fmaxf(texel[3], 0.0f), 1.0f);
+		for (uint32_t c = 0; c < 3; c++) {
+			float color = texel[c] / fmaxf(texel[3], 1e-8f);
+			color = fminf(fmaxf(color, 0.0f), 1.0f);
+			pixels[4 * i + c] = tables->to_encoded[(int32_t)(color * MIPMAP_ENCODE_TABLE_SIZE + 0.5f)];
+		}
+		pixels[4 * i + 3] = (uint8_t)(alpha * 255.0f + 0.5f);
+	}
+}
+
+uint32_t mipmap_level_dimension(uint32_t size, uint32_t level) {
+	return size >> level ? size >> level : 1;
+}
+
+uint32_t mipmap_level_count(uint32_t width, uint32_t height) {
+	uint32_t level_count = 1;
+	while ((width >> level_count) || (height >> level_count))
+		level_count++;
+	return level_count < MIPMAP_MAX_LEVELS ? level_count : MIPMAP_MAX_LEVELS;
+}
+
+// A level being downsampled. Rows are fetched one at a time, so level 0 is decoded as it is read
+// instead of expanding the whole image to floats.
+typedef struct {
+	uint32_t width, height;
+	const float *texels;
+	const uint8_t *pixels;
+	uint32_t channels;
+	const MipmapTables *tables;
+} MipmapSource;
+
+// Where a level is written, each finished row is also encoded when encoded is set
+typedef struct {
+	float *texels;
+	uint8_t *encoded;
+	const MipmapTables *tables;
+} MipmapTarget;
+
+static const float *mipmap_source_row(const MipmapSource *source, uint32_t y, float *buffer) {
+	if (source->texels)
+		return source->texels + (size_t)y * source->width * 4;
+	mipmap_decode(source->tables, source->pixels + (size_t)y * source->width * source->channels, source->channels, source->width, buffer);
+	return buffer;
+}
+
+static void mipmap_target_row(const MipmapTarget *target, uint32_t y, uint32_t width) {
+	if (target->encoded)
+		mipmap_encode(target->tables, target->texels + (size_t)y * width * 4, width, target->encoded + (size_t)y * width * 4);
+}
+
+// Two decoded source rows for the box filter, or one plus the ring of filtered rows for Kaiser
+static size_t mipmap_scratch_size(uint32_t width) {
+	return ((size_t)2 * width + (size_t)MIPMAP_KAISER_TAPS * mipmap_level_dimension(width, 1)) * 4 * sizeof(float);
+}
+
+// Averages 2x2 texels, odd edges repeat their last row or column
+static void mipmap_box(const MipmapSource *source, const MipmapTarget *target, float *scratch) {
+	uint32_t width = source->width, height = source->height;
+	uint32_t next_width = mipmap_level_dimension(width, 1), next_height = mipmap_level_dimension(height, 1);
+	for (uint32_t y = 0; y < next_height; y++) {
+		const float *row0 = mipmap_source_row(source, 2 * y < height ? 2 * y : height - 1, scratch);
+		const float *row1 = mipmap_source_row(source, 2 * y + 1 < height ? 2 * y + 1 : height - 1, scratch + (size_t)width * 4);
+		float *out = target->texels + (size_t)y * next_width * 4;
+
+		// Pairs that lie fully inside the row, then the repeated last column of odd widths
+		uint32_t x = 0;
+		for (; 2 * x + 1 < width; x++) {
+			Texel sum = texel_add(texel_add(texel_load(row0 + 8 * x), texel_load(row0 + 8 * x + 4)),
+				texel_add(texel_load(row1 + 8 * x), texel_load(row1 + 8 * x + 4)));
+			texel_store(out + 4 * x, texel_scale(sum, 0.25f));
+		}
+		for (; x < next_width; x++) {
+			uint32_t last = width - 1;
+			Texel sum = texel_add(texel_load(row0 + 4 * last), texel_load(row1 + 4 * last));
+			texel_store(out + 4 * x, texel_scale(sum, 0.5f));
+		}
+		mipmap_target_row(target, y, next_width);
+	}
+}
+
+static double bessel_i0(double x) {
+	double sum = 1.0, term = 1.0;
+	for (uint32_t k = 1; k < 32 && term > 1e-12 * sum; k++) {
+		term *= (x * x) / (4.0 * k * k);
+		sum += term;
+	}
+	return sum;
+}
+
+// Half band sinc, since every output texel covers two source texels, under a Kaiser window
+// reaching zero just past the outer taps
+static void kaiser_weights(float weights[MIPMAP_KAISER_TAPS]) {
+	const double pi = 3.14159265358979323846, radius = MIPMAP_KAISER_TAPS / 2;
+	double sum = 0.0, taps[MIPMAP_KAISER_TAPS];
+	for (uint32_t t = 0; t < MIPMAP_KAISER_TAPS; t++) {
+		double distance = t - (MIPMAP_KAISER_TAPS - 1) / 2.0;
+		double x = pi * distance / 2.0;
+		double ratio = distance / radius;
+		taps[t] = sin(x) / x * bessel_i0(MIPMAP_KAISER_BETA * sqrt(1.0 - ratio * ratio)) / bessel_i0(MIPMAP_KAISER_BETA);
+		sum += taps[t];
+	}
+	for (uint32_t t = 0; t < MIPMAP_KAISER_TAPS; t++)
+		weights[t] = (float)(taps[t] / sum);
+}
+
+static inline uint32_t clamp_index(int64_t index, uint32_t size) {
+	return index < 0 ? 0 : index >= size ? size - 1 : (uint32_t)index;
+}
+
+static void kaiser_horizontal(const float *row, uint32_t width, const float weights[MIPMAP_KAISER_TAPS], float *out) {
+	const int64_t reach = MIPMAP_KAISER_TAPS / 2 - 1;
+	uint32_t next_width = mipmap_level_dimension(width, 1);
+	for (uint32_t x = 0; x < next_width; x++) {
+		int64_t first = 2 * (int64_t)x - reach;
+		Texel sum = texel_zero();
+		if (first >= 0 && first + MIPMAP_KAISER_TAPS <= width) {
+			for (uint32_t t = 0; t < MIPMAP_KAISER_TAPS; t++)
+				sum = texel_madd(sum, texel_load(row + 4 * (first + t)), weights[t]);
+		} else {
+			for (uint32_t t = 0; t < MIPMAP_KAISER_TAPS; t++)
+				sum = texel_madd(sum, texel_load(row + 4 * clamp_index(first + t, width)), weights[t]);
+		}
+		texel_store(out + 4 * x, sum);
+	}
+}
+
+// Separable: source rows are filtered horizontally into a ring as the vertical pass first
+// needs them, each row exactly once
+static void mipmap_kaiser(const MipmapSource *source, const MipmapTarget *target, float *scratch) {
+	uint32_t width = source->width, height = source->height;
+	uint32_t next_width = mipmap_level_dimension(width, 1), next_height = mipmap_level_dimension(height, 1);
+	float *ring = scratch + (size_t)2 * width * 4;
+
+	float weights[MIPMAP_KAISER_TAPS];
+	kaiser_weights(weights);
+	const int64_t reach = MIPMAP_KAISER_TAPS / 2 - 1;
+
+	int64_t filtered = -1;
+	for (uint32_t y = 0; y < next_height; y++) {
+		const float *rows[MIPMAP_KAISER_TAPS];
+		for (uint32_t t = 0; t < MIPMAP_KAISER_TAPS; t++) {
+			uint32_t index = clamp_index(2 * (int64_t)y - reach + t, height);
+			while (filtered < index) {
+				filtered++;
+				float *slot = ring + (size_t)(filtered % MIPMAP_KAISER_TAPS) * next_width * 4;
+				kaiser_horizontal(mipmap_source_row(source, (uint32_t)filtered, scratch), width, weights, slot);
+			}
+			rows[t] = ring + (size_t)(index % MIPMAP_KAISER_TAPS) * next_width * 4;
+		}
+
+		float *out = target->texels + (size_t)y * next_width * 4;
+		for (uint32_t x = 0; x < next_width; x++) {
+			Texel sum = texel_zero();
+			for (uint32_t t = 0; t < MIPMAP_KAISER_TAPS; t++)
+				sum = texel_madd(sum, texel_load(rows[t] + 4 * x), weights[t]);
+			texel_store(out + 4 * x, texel_clamp(sum));
+		}
+		mipmap_target_row(target, y, next_width);
+	}
+}
+
+static void mipmap_downsample_level(MipmapFilter filter, const MipmapSource *source, const MipmapTarget *target, float *scratch) {
+	if (filter == MIPMAP_FILTER_KAISER)
+		mipmap_kaiser(source, target, scratch);
+	else
+		mipmap_box(source, target, scratch);
+}
+
+bool mipmap_downsample(MipmapFilter filter, const float *source, uint32_t width, uint32_t height, float *destination) {
+	float *scratch = malloc(mipmap_scratch_size(width));
+	if (scratch == NULL)
+		return false;
+
+	MipmapSource level = { .width = width, .height = height, .texels = source };
+	mipmap_downsample_level(filter, &level, &(MipmapTarget){ .texels = destination }, scratch);
+	free(scratch);
+	return true;
+}
+
+bool mipmap_generate(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t channels, bool srgb, MipmapFilter filter, MipChain *chain) {
+	*chain = (MipChain){
+		.width = width,
+		.height = height,
+		.level_count = filter == MIPMAP_FILTER_NONE ? 1 : mipmap_level_count(width, height),
+	};
+
+	for (uint32_t level = 0; level < chain->level_count; level++) {
+		chain->offsets[level] = chain->size;
+		chain->size += (size_t)mipmap_level_dimension(width, level) * mipmap_level_dimension(height, level) * 4;
+	}
+
+	chain->pixels = malloc(chain->size);
+	if (chain->pixels == NULL)
+		return false;
+
+	size_t texel_count = (size_t)width * height;
+	if (channels == 4)
+		memcpy(chain->pixels, pixels, texel_count * 4);
+	for (size_t i = 0; channels != 4 && i < texel_count; i++) {
+		const uint8_t *pixel = pixels + i * channels;
+		uint8_t *out = chain->pixels + i * 4;
+		out[0] = pixel[0];
+		out[1] = channels >= 3 ? pixel[1] : pixel[0];
+		out[2] = channels >= 3 ? pixel[2] : pixel[0];
+		out[3] = channels == 4 ? pixel[3] : channels == 2 ? pixel[1] : 255;
+	}
+	if (chain->level_count == 1)
+		return true;
+
+	// Odd levels are written to the first buffer and even ones to the second, each level reads
+	// the one before it
+	size_t level1_count = (size_t)mipmap_level_dimension(width, 1) * mipmap_level_dimension(height, 1);
+	size_t level2_count = (size_t)mipmap_level_dimension(width, 2) * mipmap_level_dimension(height, 2);
+	float *texels = malloc((level1_count + level2_count) * 4 * sizeof(float) + mipmap_scratch_size(width));
+	if (texels == NULL) {
+		mipmap_release(chain);
+		return false;
+	}
+	float *buffers[2] = { texels, texels + level1_count * 4 };
+	float *scratch = texels + (level1_count + level2_count) * 4;
+
+	MipmapTables tables;
+	mipmap_build_tables(srgb, &tables);
+
+	MipmapSource source = { .width = width, .height = height, .pixels = pixels, .channels = channels, .tables = &tables };
+	for (uint32_t level = 1; level < chain->level_count; level++) {
+		MipmapTarget target = { buffers[(level - 1) % 2], chain->pixels + chain->offsets[level], &tables };
+		mipmap_downsample_level(filter, &source, &target, scratch);
+		source = (MipmapSource){
+			.width = mipmap_level_dimension(width, level),
+			.height = mipmap_level_dimension(height, level),
+			.texels = target.texels,
+		};
+	}
+
+	free(texels);
+	return true;
+}
+
+void mipmap_release(MipChain *chain) {
+	free(chain->pixels);
+	*chain = (MipChain){ 0 };
+}
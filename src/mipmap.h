@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MIPMAP_MAX_LEVELS 16
+
+typedef enum {
+	// Level 0 only, sampled with GL_NEAREST, for pixel art drawn at its own size
+	MIPMAP_FILTER_NONE,
+	// 2x2 average, the cheapest chain
+	MIPMAP_FILTER_BOX,
+	// 8 tap Kaiser windowed sinc, sharper minification at about three times the cost of BOX
+	MIPMAP_FILTER_KAISER,
+} MipmapFilter;
+
+// Every level of an image in one allocation, RGBA8 with level 0 first
+typedef struct {
+	uint8_t *pixels;
+	uint32_t width, height, level_count;
+	size_t offsets[MIPMAP_MAX_LEVELS];
+	size_t size;
+} MipChain;
+
+uint32_t mipmap_level_count(uint32_t width, uint32_t height);
+uint32_t mipmap_level_dimension(uint32_t size, uint32_t level);
+
+// Downsamples in linear light with premultiplied alpha, so midtones keep their brightness and
+// transparent texels do not bleed their color into the edges. srgb tells whether the color
+// channels are sRGB encoded, alpha is always linear. Safe to call from any thread.
+bool mipmap_generate(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t channels, bool srgb, MipmapFilter filter, MipChain *chain);
+void mipmap_release(MipChain *chain);
+
+// The kernels alone on linear, premultiplied RGBA floats. destination holds
+// mipmap_level_dimension(width, 1) x mipmap_level_dimension(height, 1) texels.
+bool mipmap_downsample(MipmapFilter filter, const float *source, uint32_t width, uint32_t height, float *destination);
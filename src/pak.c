@@ -0,0 +1,173 @@
+#include "pak.h"
+
+#include "core/logger.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PAK_MAGIC 0x4B415042u // "BPAK"
+#define PAK_VERSION 2
+
+typedef struct {
+	uint32_t magic, version;
+	uint32_t entry_count, entry_size;
+} PakHeader;
+
+static const char *skip_current_directory(const char *name) {
+	while (name[0] == '.' && name[1] == '/')
+		name += 2;
+	return name;
+}
+
+static bool entry_valid(const PakEntry *entry, size_t size) {
+	if (entry->offset > size || entry->size > size - entry->offset || memchr(entry->name, '\0', PAK_NAME_LENGTH) == NULL)
+		return false;
+
+	switch (entry->type) {
+		// The terminator follows the blob
+		case PAK_ENTRY_FILE: return entry->size < size - entry->offset;
+		case PAK_ENTRY_IMAGE: return entry->size == (uint64_t)entry->width * entry->height * entry->channels;
+		case PAK_ENTRY_LEVEL: return entry->size == (uint64_t)entry->width * entry->height;
+		default: return false;
+	}
+}
+
+bool pak_open(const char *path, Pak *pak) {
+	*pak = (Pak){ 0 };
+	if (!file_map(path, &pak->mapping))
+		return false;
+
+	const uint8_t *data = pak->mapping.data;
+	size_t size = pak->mapping.size;
+	const PakHeader *header = (const PakHeader *)data;
+	if (size < sizeof(PakHeader) || header->magic != PAK_MAGIC || header->version != PAK_VERSION || header->entry_size != sizeof(PakEntry) ||
+		header->entry_count > (size - sizeof(PakHeader)) / sizeof(PakEntry)) {
+		LOG_ERROR("PAK: %s is not a version %d archive", path, PAK_VERSION);
+		pak_close(pak);
+		return false;
+	}
+
+	pak->entries = (const PakEntry *)(data + sizeof(PakHeader));
+	pak->entry_count = header->entry_count;
+	for (uint32_t i = 0; i < pak->entry_count; i++) {
+		if (!entry_valid(&pak->entries[i], size)) {
+			LOG_ERROR("PAK: %s entry %u is truncated", path, i);
+			pak_close(pak);
+			return false;
+		}
+	}
+	return true;
+}
+
+void pak_close(Pak *pak) {
+	file_unmap(&pak->mapping);
+	*pak = (Pak){ 0 };
+}
+
+const PakEntry *pak_find(const Pak *pak, const char *name) {
+	name = skip_current_directory(name);
+
+	uint32_t low = 0, high = pak->entry_count;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		int order = strcmp(pak->entries[middle].name, name);
+		if (order == 0)
+			return &pak->entries[middle];
+		if (order < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return NULL;
+}
+
+const uint8_t *pak_entry_data(const Pak *pak, const PakEntry *entry) {
+	return pak->mapping.data + entry->offset;
+}
+
+bool pak_normalize_name(const char *path, char *name) {
+	path = skip_current_directory(path);
+	size_t length = strlen(path);
+	if (length >= PAK_NAME_LENGTH)
+		return false;
+
+	memset(name, 0, PAK_NAME_LENGTH);
+	for (size_t i = 0; i < length; i++)
+		name[i] = path[i] == '\\' ? '/' : path[i];
+	return true;
+}
+
+static int compare_sources(const void *a, const void *b) {
+	return strcmp(((const PakSource *)a)->name, ((const PakSource *)b)->name);
+}
+
+static bool write_padding(FILE *file, uint64_t *offset) {
+	static const uint8_t zeros[PAK_ALIGNMENT] = { 0 };
+	size_t padding = (PAK_ALIGNMENT - *offset % PAK_ALIGNMENT) % PAK_ALIGNMENT;
+	*offset += padding;
+	return fwrite(zeros, 1, padding, file) == padding;
+}
+
+bool pak_write(const char *path, PakSource *sources, uint32_t count) {
+	qsort(sources, count, sizeof(PakSource), compare_sources);
+	for (uint32_t i = 1; i < count; i++) {
+		if (strcmp(sources[i - 1].name, sources[i].name) == 0) {
+			LOG_ERROR("PAK: %s is packed twice", sources[i].name);
+			return false;
+		}
+	}
+
+	PakEntry *entries = calloc(count ? count : 1, sizeof(PakEntry));
+	if (entries == NULL)
+		return false;
+
+	// Lay the blobs out first so the table of contents is written in one go
+	uint64_t offset = sizeof(PakHeader) + (uint64_t)count * sizeof(PakEntry);
+	for (uint32_t i = 0; i < count; i++) {
+		offset += (PAK_ALIGNMENT - offset % PAK_ALIGNMENT) % PAK_ALIGNMENT;
+		memcpy(entries[i].name, sources[i].name, PAK_NAME_LENGTH);
+		entries[i].type = sources[i].type;
+		entries[i].width = sources[i].width;
+		entries[i].height = sources[i].height;
+		entries[i].channels = sources[i].channels;
+		entries[i].offset = offset;
+		entries[i].size = sources[i].size;
+		entries[i].hash = sources[i].hash;
+		offset += sources[i].size + (sources[i].type == PAK_ENTRY_FILE);
+	}
+
+	FILE *file = fopen(path, "wb");
+	if (file == NULL) {
+		LOG_ERROR("PAK: Cannot write '%s': %s", path, strerror(errno));
+		free(entries);
+		return false;
+	}
+
+	PakHeader header = {
+		.magic = PAK_MAGIC,
+		.version = PAK_VERSION,
+		.entry_count = count,
+		.entry_size = sizeof(PakEntry),
+	};
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(entries, sizeof(PakEntry), count, file) == count;
+
+	offset = sizeof(PakHeader) + (uint64_t)count * sizeof(PakEntry);
+	for (uint32_t i = 0; i < count && success; i++) {
+		success = write_padding(file, &offset) && fwrite(sources[i].data, 1, sources[i].size, file) == sources[i].size;
+		offset += sources[i].size;
+		if (success && sources[i].type == PAK_ENTRY_FILE) {
+			success = fputc('\0', file) != EOF;
+			offset++;
+		}
+	}
+
+	success = fclose(file) == 0 && success;
+	free(entries);
+	if (!success) {
+		LOG_ERROR("PAK: Failed writing '%s'", path);
+		remove(path);
+	}
+	return success;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "core/file.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PAK_NAME_LENGTH 128
+// Blobs start on a cache line, so texels can be read in place with aligned SIMD loads
+#define PAK_ALIGNMENT 64
+
+typedef enum {
+	// Raw file contents followed by a terminator that size does not count, so text can be
+	// used as a C string straight from the mapping
+	PAK_ENTRY_FILE,
+	// Decoded 8 bit texels with the channel count of the source image
+	PAK_ENTRY_IMAGE,
+	// A level's tile grid, one byte per tile with width columns and height rows
+	PAK_ENTRY_LEVEL,
+} PakEntryType;
+
+// Table of contents entry, sorted by name. The archive is a PakHeader, entry_count of these and
+// the blobs, all little endian and read in place.
+typedef struct {
+	// Path relative to the game directory with '/' separators and no leading "./"
+	char name[PAK_NAME_LENGTH];
+	uint32_t type;
+	uint32_t width, height, channels;
+	uint64_t offset, size;
+	// Hash of the source the blob was cooked from, lets the cooker skip unchanged assets
+	uint64_t hash;
+} PakEntry;
+
+typedef struct {
+	FileMapping mapping;
+	const PakEntry *entries;
+	uint32_t entry_count;
+} Pak;
+
+// Returns false without logging when the archive does not exist
+bool pak_open(const char *path, Pak *pak);
+void pak_close(Pak *pak);
+// Binary search of the table of contents, a leading "./" in name is ignored
+const PakEntry *pak_find(const Pak *pak, const char *name);
+const uint8_t *pak_entry_data(const Pak *pak, const PakEntry *entry);
+
+// One blob to pack, for the offline packer
+typedef struct {
+	char name[PAK_NAME_LENGTH];
+	PakEntryType type;
+	uint32_t width, height, channels;
+	const void *data;
+	size_t size;
+	uint64_t hash;
+} PakSource;
+
+// Sorts sources by name and writes the archive
+bool pak_write(const char *path, PakSource *sources, uint32_t count);
+// Strips a leading "./" and turns '\\' into '/', false when the result does not fit a PakEntry
+bool pak_normalize_name(const char *path, char *name);
@@ -0,0 +1,158 @@
+#include "profiler.h"
+
+#include "core/clock.h"
+#include "core/logger.h"
+
+#include <glad/gl.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define PROFILER_LATENCY 4
+#define PROFILER_WINDOW 128
+
+typedef struct {
+	uint64_t samples[PROFILER_WINDOW];
+	uint32_t count, next;
+} TimingSeries;
+
+typedef struct {
+	bool gpu;
+	uint32_t frame;
+
+	// Begin/end timestamp query per pass for each frame in flight
+	uint32_t queries[PROFILER_LATENCY][PROFILER_PASS_COUNT][2];
+	bool issued[PROFILER_LATENCY][PROFILER_PASS_COUNT];
+
+	uint64_t pass_start[PROFILER_PASS_COUNT];
+	uint64_t cpu_start[PROFILER_CPU_COUNT];
+
+	TimingSeries passes[PROFILER_PASS_COUNT];
+	TimingSeries cpu[PROFILER_CPU_COUNT];
+} Profiler;
+
+static Profiler g_profiler = { 0 };
+
+static const char *g_pass_names[PROFILER_PASS_COUNT] = { "clear", "bricks", "sprites", "ui" };
+static const char *g_cpu_scope_names[PROFILER_CPU_COUNT] = { "game_update", "game_draw" };
+
+static void series_push(TimingSeries *series, uint64_t nanoseconds) {
+	series->samples[series->next] = nanoseconds;
+	series->next = (series->next + 1) % PROFILER_WINDOW;
+	if (series->count < PROFILER_WINDOW)
+		series->count++;
+}
+
+static int compare_u64(const void *a, const void *b) {
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+static ProfilerTiming series_timing(const TimingSeries *series) {
+	ProfilerTiming timing = { .sample_count = series->count };
+	if (series->count == 0)
+		return timing;
+
+	uint64_t sorted[PROFILER_WINDOW], total = 0;
+	memcpy(sorted, series->samples, series->count * sizeof(*sorted));
+	qsort(sorted, series->count, sizeof(*sorted), compare_u64);
+	for (uint32_t i = 0; i < series->count; i++)
+		total += sorted[i];
+
+	uint32_t p99 = (series->count * 99 + 99) / 100 - 1;
+	timing.min_ms = sorted[0] / 1e6;
+	timing.average_ms = (double)total / series->count / 1e6;
+	timing.p99_ms = sorted[p99] / 1e6;
+	return timing;
+}
+
+void profiler_startup(bool gpu) {
+	g_profiler = (Profiler){ .gpu = gpu };
+	if (gpu)
+		glCreateQueries(GL_TIMESTAMP, PROFILER_LATENCY * PROFILER_PASS_COUNT * 2, &g_profiler.queries[0][0][0]);
+}
+
+void profiler_shutdown(void) {
+	if (g_profiler.gpu)
+		glDeleteQueries(PROFILER_LATENCY * PROFILER_PASS_COUNT * 2, &g_profiler.queries[0][0][0]);
+	g_profiler.gpu = false;
+}
+
+void profiler_begin_frame(void) {
+	g_profiler.frame++;
+	if (!g_profiler.gpu)
+		return;
+
+	// The slot about to be reused was issued PROFILER_LATENCY frames ago, collect it if the GPU is
+	// done and drop the sample otherwise rather than stalling
+	uint32_t slot = g_profiler.frame % PROFILER_LATENCY;
+	for (uint32_t pass = 0; pass < PROFILER_PASS_COUNT; pass++) {
+		if (!g_profiler.issued[slot][pass])
+			continue;
+		g_profiler.issued[slot][pass] = false;
+
+		uint32_t available = 0;
+		glGetQueryObjectuiv(g_profiler.queries[slot][pass][1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			continue;
+
+		uint64_t begin = 0, end = 0;
+		glGetQueryObjectui64v(g_profiler.queries[slot][pass][0], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(g_profiler.queries[slot][pass][1], GL_QUERY_RESULT, &end);
+		series_push(&g_profiler.passes[pass], end > begin ? end - begin : 0);
+	}
+}
+
+void profiler_begin_pass(ProfilerPass pass) {
+	if (g_profiler.gpu)
+		glQueryCounter(g_profiler.queries[g_profiler.frame % PROFILER_LATENCY][pass][0], GL_TIMESTAMP);
+	else
+		g_profiler.pass_start[pass] = clock_now_ns();
+}
+
+void profiler_end_pass(ProfilerPass pass) {
+	if (g_profiler.gpu) {
+		uint32_t slot = g_profiler.frame % PROFILER_LATENCY;
+		glQueryCounter(g_profiler.queries[slot][pass][1], GL_TIMESTAMP);
+		g_profiler.issued[slot][pass] = true;
+	} else {
+		series_push(&g_profiler.passes[pass], clock_now_ns() - g_profiler.pass_start[pass]);
+	}
+}
+
+void profiler_cpu_begin(ProfilerCpuScope scope) {
+	g_profiler.cpu_start[scope] = clock_now_ns();
+}
+
+void profiler_cpu_end(ProfilerCpuScope scope) {
+	series_push(&g_profiler.cpu[scope], clock_now_ns() - g_profiler.cpu_start[scope]);
+}
+
+ProfilerTiming profiler_pass_timing(ProfilerPass pass) {
+	return series_timing(&g_profiler.passes[pass]);
+}
+
+ProfilerTiming profiler_cpu_timing(ProfilerCpuScope scope) {
+	return series_timing(&g_profiler.cpu[scope]);
+}
+
+const char *profiler_pass_name(ProfilerPass pass) {
+	return g_pass_names[pass];
+}
+
+const char *profiler_cpu_scope_name(ProfilerCpuScope scope) {
+	return g_cpu_scope_names[scope];
+}
+
+void profiler_log_summary(void) {
+	for (uint32_t pass = 0; pass < PROFILER_PASS_COUNT; pass++) {
+		ProfilerTiming timing = profiler_pass_timing(pass);
+		LOG_INFO("PROFILER: %s pass %-8s min %.3f ms, avg %.3f ms, p99 %.3f ms (%d samples)",
+			g_profiler.gpu ? "GPU" : "CPU", g_pass_names[pass], timing.min_ms, timing.average_ms, timing.p99_ms, timing.sample_count);
+	}
+	for (uint32_t scope = 0; scope < PROFILER_CPU_COUNT; scope++) {
+		ProfilerTiming timing = profiler_cpu_timing(scope);
+		LOG_INFO("PROFILER: CPU %-12s min %.3f ms, avg %.3f ms, p99 %.3f ms (%d samples)",
+			g_cpu_scope_names[scope], timing.min_ms, timing.average_ms, timing.p99_ms, timing.sample_count);
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+	PROFILER_PASS_CLEAR,
+	PROFILER_PASS_BRICKS,
+	PROFILER_PASS_SPRITES,
+	PROFILER_PASS_UI,
+
+	PROFILER_PASS_COUNT
+} ProfilerPass;
+
+typedef enum {
+	PROFILER_CPU_UPDATE,
+	PROFILER_CPU_DRAW,
+
+	PROFILER_CPU_COUNT
+} ProfilerCpuScope;
+
+typedef struct {
+	double min_ms, average_ms, p99_ms;
+	uint32_t sample_count;
+} ProfilerTiming;
+
+// With gpu set, passes are timed with GL_TIMESTAMP queries that are read back PROFILER_LATENCY
+// frames later without blocking. Without a GL context passes are timed on the CPU instead.
+void profiler_startup(bool gpu);
+void profiler_shutdown(void);
+void profiler_begin_frame(void);
+
+void profiler_begin_pass(ProfilerPass pass);
+void profiler_end_pass(ProfilerPass pass);
+
+void profiler_cpu_begin(ProfilerCpuScope scope);
+void profiler_cpu_end(ProfilerCpuScope scope);
+
+// Rolling statistics over the last PROFILER_WINDOW samples
+ProfilerTiming profiler_pass_timing(ProfilerPass pass);
+ProfilerTiming profiler_cpu_timing(ProfilerCpuScope scope);
+
+const char *profiler_pass_name(ProfilerPass pass);
+const char *profiler_cpu_scope_name(ProfilerCpuScope scope);
+void profiler_log_summary(void);
@@ -0,0 +1,130 @@
+#include "release_queue.h"
+
+#include "core/logger.h"
+#include "shader.h"
+#include "texture.h"
+
+#include <glad/gl.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+// Frames a release can stay in flight before release_queue_update blocks on it
+#define RELEASE_QUEUE_BATCHES 4
+
+typedef struct {
+	OpenGLTexture *texture;
+	OpenGLShader *shader;
+} ReleasedObject;
+
+typedef struct {
+	ReleasedObject *objects;
+	uint32_t count, capacity;
+	GLsync fence;
+} ReleaseBatch;
+
+typedef struct {
+	// A ring, batches from oldest up to current are fenced and current collects new releases
+	ReleaseBatch batches[RELEASE_QUEUE_BATCHES];
+	uint32_t oldest, current;
+	uint32_t pending_count;
+} ReleaseQueue;
+
+static ReleaseQueue g_release_queue = { 0 };
+
+static void release_object(ReleasedObject object) {
+	if (object.texture)
+		opengl_texture_destroy(object.texture);
+	if (object.shader)
+		opengl_shader_destroy(object.shader);
+}
+
+static void release_queue_push(ReleasedObject object) {
+	ReleaseBatch *batch = &g_release_queue.batches[g_release_queue.current];
+	if (batch->count == batch->capacity) {
+		uint32_t capacity = batch->capacity ? batch->capacity * 2 : 64;
+		ReleasedObject *objects = realloc(batch->objects, capacity * sizeof(ReleasedObject));
+		if (objects == NULL) {
+			// Without room to defer it, waiting for the GPU is the only safe way out
+			LOG_WARN("RELEASE_QUEUE: Out of memory, waiting for the GPU to destroy an object");
+			glFinish();
+			release_object(object);
+			return;
+		}
+		batch->objects = objects;
+		batch->capacity = capacity;
+	}
+
+	batch->objects[batch->count++] = object;
+	g_release_queue.pending_count++;
+}
+
+void release_queue_texture(OpenGLTexture *texture) {
+	if (texture == NULL)
+		return;
+	if (opengl_texture_headless())
+		opengl_texture_destroy(texture);
+	else
+		release_queue_push((ReleasedObject){ .texture = texture });
+}
+
+void release_queue_shader(OpenGLShader *shader) {
+	if (shader)
+		release_queue_push((ReleasedObject){ .shader = shader });
+}
+
+// Destroys the batch once its fence signaled, or right away when wait is set
+static bool release_batch_retire(ReleaseBatch *batch, bool wait) {
+	if (batch->fence) {
+		GLenum result = glClientWaitSync(batch->fence, 0, 0);
+		while (wait && result == GL_TIMEOUT_EXPIRED)
+			result = glClientWaitSync(batch->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		if (result == GL_TIMEOUT_EXPIRED)
+			return false;
+		if (result == GL_WAIT_FAILED)
+			LOG_ERROR("RELEASE_QUEUE: glClientWaitSync failed");
+
+		glDeleteSync(batch->fence);
+		batch->fence = NULL;
+	}
+
+	for (uint32_t i = 0; i < batch->count; i++)
+		release_object(batch->objects[i]);
+	g_release_queue.pending_count -= batch->count;
+	batch->count = 0;
+	return true;
+}
+
+void release_queue_update(void) {
+	ReleaseQueue *queue = &g_release_queue;
+
+	ReleaseBatch *current = &queue->batches[queue->current];
+	if (current->count > 0) {
+		current->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		queue->current = (queue->current + 1) % RELEASE_QUEUE_BATCHES;
+		if (queue->current == queue->oldest) {
+			release_batch_retire(&queue->batches[queue->oldest], true);
+			queue->oldest = (queue->oldest + 1) % RELEASE_QUEUE_BATCHES;
+		}
+	}
+
+	// Fences signal in submission order, so the first one still pending ends the walk
+	while (queue->oldest != queue->current && release_batch_retire(&queue->batches[queue->oldest], false))
+		queue->oldest = (queue->oldest + 1) % RELEASE_QUEUE_BATCHES;
+}
+
+void release_queue_flush(void) {
+	ReleaseQueue *queue = &g_release_queue;
+	if (queue->pending_count > 0 && !opengl_texture_headless())
+		glFinish();
+
+	for (uint32_t i = 0; i < RELEASE_QUEUE_BATCHES; i++) {
+		release_batch_retire(&queue->batches[i], true);
+		free(queue->batches[i].objects);
+	}
+	*queue = (ReleaseQueue){ 0 };
+}
+
+uint32_t release_queue_pending(void) {
+	return g_release_queue.pending_count;
+}
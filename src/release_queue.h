@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef struct _gl_texture OpenGLTexture;
+typedef struct _gl_shader OpenGLShader;
+
+// Destroys textures and shaders once the GPU finished every command submitted before their
+// release. Releases are collected per frame and the batch gets one fence when the next frame
+// begins, so a frame can still draw with what it released. Headless textures are destroyed
+// right away.
+void release_queue_texture(OpenGLTexture *texture);
+void release_queue_shader(OpenGLShader *shader);
+
+// Fences the batch released during the last frame and destroys every batch whose fence signaled.
+// Waits for the oldest batch when all of them are in flight.
+void release_queue_update(void);
+// Waits for the GPU and destroys everything released so far
+void release_queue_flush(void);
+
+uint32_t release_queue_pending(void);
@@ -0,0 +1,87 @@
+#include "render_queue.h"
+
+#include "core/arena.h"
+
+struct _render_queue {
+	RenderCommand *commands;
+	uint32_t count, capacity;
+};
+
+typedef struct {
+	uint64_t key;
+	uint32_t index;
+} SortEntry;
+
+uint64_t render_queue_key(uint8_t layer, uint32_t shader, uint32_t texture, uint32_t depth) {
+	return ((uint64_t)layer << RENDER_KEY_LAYER_SHIFT) |
+		((uint64_t)(shader & 0xFFF) << RENDER_KEY_SHADER_SHIFT) |
+		((uint64_t)(texture & 0xFFF) << RENDER_KEY_TEXTURE_SHIFT) |
+		(uint64_t)depth;
+}
+
+RenderQueue *render_queue_create(Arena *arena, uint32_t capacity) {
+	RenderQueue *queue = arena_push_type(arena, RenderQueue);
+	*queue = (RenderQueue){
+		.commands = arena_push_array(arena, RenderCommand, capacity),
+		.capacity = capacity,
+	};
+	return queue;
+}
+
+void render_queue_reset(RenderQueue *queue) {
+	queue->count = 0;
+}
+
+RenderCommand *render_queue_push(RenderQueue *queue) {
+	if (queue->count == queue->capacity)
+		return NULL;
+	return &queue->commands[queue->count++];
+}
+
+uint32_t render_queue_count(const RenderQueue *queue) {
+	return queue->count;
+}
+
+const RenderCommand *render_queue_command(const RenderQueue *queue, uint32_t index) {
+	return &queue->commands[index];
+}
+
+uint32_t *render_queue_sort(RenderQueue *queue, Arena *scratch) {
+	uint32_t count = queue->count;
+	SortEntry *entries = arena_push_array(scratch, SortEntry, count);
+	SortEntry *swap = arena_push_array(scratch, SortEntry, count);
+
+	for (uint32_t i = 0; i < count; i++)
+		entries[i] = (SortEntry){ queue->commands[i].key, i };
+
+	for (uint32_t shift = 0; shift < 64; shift += 8) {
+		uint32_t histogram[256] = { 0 };
+		for (uint32_t i = 0; i < count; i++)
+			histogram[(entries[i].key >> shift) & 0xFF]++;
+
+		// Every key shares this byte, the pass would not move anything
+		if (count == 0 || histogram[(entries[0].key >> shift) & 0xFF] == count)
+			continue;
+
+		uint32_t offset = 0;
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t bucket_count = histogram[i];
+			histogram[i] = offset;
+			offset += bucket_count;
+		}
+
+		for (uint32_t i = 0; i < count; i++)
+			swap[histogram[(entries[i].key >> shift) & 0xFF]++] = entries[i];
+
+		SortEntry *temporary = entries;
+		entries = swap;
+		swap = temporary;
+	}
+
+	// Compact the order in place over whichever buffer holds the result
+	uint32_t *order = (uint32_t *)entries;
+	for (uint32_t i = 0; i < count; i++)
+		order[i] = entries[i].index;
+
+	return order;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef struct _arena Arena;
+typedef struct _gl_shader OpenGLShader;
+typedef struct _texture_region TextureRegion;
+
+typedef struct _render_queue RenderQueue;
+
+// 64-bit sort key, most significant first: layer (8) | shader (12) | texture (12) | depth (32).
+// Shader and texture are GL object names truncated to 12 bits; a collision only costs a batch.
+#define RENDER_KEY_LAYER_SHIFT 56
+#define RENDER_KEY_SHADER_SHIFT 44
+#define RENDER_KEY_TEXTURE_SHIFT 32
+
+typedef struct {
+	uint64_t key;
+	OpenGLShader *shader;
+	TextureRegion *region;
+	float position[2], size[2];
+	float rotation;
+	float color[3];
+} RenderCommand;
+
+uint64_t render_queue_key(uint8_t layer, uint32_t shader, uint32_t texture, uint32_t depth);
+
+// Command storage is carved out of arena once; recording never allocates
+RenderQueue *render_queue_create(Arena *arena, uint32_t capacity);
+void render_queue_reset(RenderQueue *queue);
+
+// Returns NULL when the queue is full
+RenderCommand *render_queue_push(RenderQueue *queue);
+uint32_t render_queue_count(const RenderQueue *queue);
+
+// LSD radix sort of the recorded keys. The returned order indexes render_queue_command and lives
+// in scratch, release it with arena_set once the commands have been consumed.
+uint32_t *render_queue_sort(RenderQueue *queue, Arena *scratch);
+const RenderCommand *render_queue_command(const RenderQueue *queue, uint32_t index);
@@ -1,8 +1,15 @@
 #include "renderer.h"
 
 #include "core/arena.h"
+#include "gl_state.h"
+#include "render_queue.h"
+#include "ring_buffer.h"
 #include "shader.h"
+#include "software_renderer.h"
 #include "texture.h"
+#include "texture_residency.h"
+#include "transform.h"
+#include "types.h"
 
 #include <cglm/affine-pre.h>
 #include <cglm/affine.h>
@@ -10,15 +17,103 @@
 #include <cglm/util.h>
 #include <glad/gl.h>
 
+#include <math.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define RENDERER_MAX_BATCH_SPRITES 4096
+#define RENDERER_VERTICES_PER_SPRITE 6
+// Each region holds one frame of sprite data plus the frame block
+#define RENDERER_STREAM_REGION_SIZE (4 * RENDERER_MAX_BATCH_SPRITES * sizeof(SpriteData))
+#define RENDERER_STREAM_REGIONS 3
+#define RENDERER_MAX_COMMANDS (1 << 16)
+// Sorted commands are transformed this many at a time by the SIMD kernel
+#define RENDERER_TRANSFORM_CHUNK 256
+
+// Binding points of the Frame uniform block and the Sprites storage block in the shaders
+#define RENDERER_FRAME_BINDING 0
+#define RENDERER_SPRITE_BINDING 0
+
+// std140 layout of the Frame block
+typedef struct {
+	mat4 projection;
+	float screen_size[2];
+	float time;
+	float padding;
+} FrameData;
+
+// std430 layout of one Sprites element, read by gl_InstanceID
+typedef struct {
+	Affine2D transform;
+	float uv[4];
+	// rgb and the texture array layer
+	float color[4];
+} SpriteData;
+
+typedef struct {
+	float rect[4];
+	float uv[4];
+	float color[3];
+	float rotation;
+	float layer;
+} SpriteInstance;
+
+struct _instance_layer {
+	OpenGLShader *shader;
+	// Resolved on every draw, a reloaded texture replaces the one the region pointed at
+	TextureRegion *region;
+
+	uint32_t buffer;
+	SpriteInstance *instances;
+	uint32_t count;
+
+	uint32_t dirty_begin, dirty_end;
+};
 
 struct _renderer {
-	uint32_t quad_vao;
+	RendererBackend backend;
+	SoftwareRenderer *software;
+
+	uint32_t quad_vao, quad_vbo;
 	OpenGLShader *shader;
+
+	// Sprite data and the frame block are streamed through the same ring buffer
+	OpenGLRingBuffer *stream;
+	uint32_t uniform_alignment, storage_alignment;
+	FrameData frame;
+	// Stream generation the bound frame block was pushed in
+	uint32_t frame_generation;
+
+	uint32_t batch_vao;
+	SpriteData *sprites;
+	uint32_t sprite_count, sprite_capacity;
+	size_t sprite_offset;
+
+	OpenGLShader *batch_shader;
+	OpenGLTexture *batch_texture;
+
+	// Commands and their sort scratch live in frame_arena, which is rewound to frame_base every frame
+	Arena *frame_arena;
+	size_t frame_base;
+	RenderQueue *queue;
+	uint8_t layer;
+	uint32_t depth;
+
+	RendererStats stats;
 };
 
+static void renderer_create_queue(Renderer *renderer) {
+	renderer->frame_arena = arena_alloc();
+	renderer->queue = render_queue_create(renderer->frame_arena, RENDERER_MAX_COMMANDS);
+	renderer->frame_base = arena_size(renderer->frame_arena);
+}
+
 Renderer *renderer_create(Arena *arena, OpenGLShader *shader) {
 	Renderer *renderer = arena_push_type(arena, Renderer);
+	*renderer = (Renderer){ 0 };
+	renderer->backend = RENDERER_BACKEND_OPENGL;
 	renderer->shader = shader;
 
 	// clang-format off
@@ -39,17 +134,15 @@ Renderer *renderer_create(Arena *arena, OpenGLShader *shader) {
 	// };
 	// clang-format on
 
-	uint32_t vbo;
-
-	glCreateBuffers(1, &vbo);
-	glNamedBufferStorage(vbo, sizeof(vertices), vertices, GL_DYNAMIC_STORAGE_BIT);
+	glCreateBuffers(1, &renderer->quad_vbo);
+	glNamedBufferStorage(renderer->quad_vbo, sizeof(vertices), vertices, GL_DYNAMIC_STORAGE_BIT);
 
 	// glCreateBuffers(1, &ibo);
 	// glNamedBufferStorage(ibo, sizeof(indices), indices, GL_DYNAMIC_STORAGE_BIT);
 
 	glCreateVertexArrays(1, &renderer->quad_vao);
 
-	glVertexArrayVertexBuffer(renderer->quad_vao, 0, vbo, 0, 4 * sizeof(*vertices));
+	glVertexArrayVertexBuffer(renderer->quad_vao, 0, renderer->quad_vbo, 0, 4 * sizeof(*vertices));
 	// glVertexArrayElementBuffer(renderer->quad_vao, ibo);
 
 	glEnableVertexArrayAttrib(renderer->quad_vao, 0);
@@ -60,28 +153,407 @@ Renderer *renderer_create(Arena *arena, OpenGLShader *shader) {
 	glVertexArrayAttribBinding(renderer->quad_vao, 0, 0);
 	// glVertexArrayAttribBinding(renderer->quad_vao, 1, 0);
 
+	// Per-instance attributes, sourced from whichever instance layer is bound to binding 1
+	glEnableVertexArrayAttrib(renderer->quad_vao, 1);
+	glEnableVertexArrayAttrib(renderer->quad_vao, 2);
+	glEnableVertexArrayAttrib(renderer->quad_vao, 3);
+	glEnableVertexArrayAttrib(renderer->quad_vao, 4);
+
+	glVertexArrayAttribFormat(renderer->quad_vao, 1, 4, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, rect));
+	glVertexArrayAttribFormat(renderer->quad_vao, 2, 4, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, color));
+	glVertexArrayAttribFormat(renderer->quad_vao, 3, 4, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, uv));
+	glVertexArrayAttribFormat(renderer->quad_vao, 4, 1, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, layer));
+	glVertexArrayAttribBinding(renderer->quad_vao, 1, 1);
+	glVertexArrayAttribBinding(renderer->quad_vao, 2, 1);
+	glVertexArrayAttribBinding(renderer->quad_vao, 3, 1);
+	glVertexArrayAttribBinding(renderer->quad_vao, 4, 1);
+	glVertexArrayBindingDivisor(renderer->quad_vao, 1, 1);
+
+	renderer->stream = opengl_ring_buffer_create(arena, RENDERER_STREAM_REGION_SIZE, RENDERER_STREAM_REGIONS);
+
+	int32_t uniform_alignment = 0, storage_alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storage_alignment);
+	renderer->uniform_alignment = uniform_alignment > 16 ? uniform_alignment : 16;
+	renderer->storage_alignment = storage_alignment > 16 ? storage_alignment : 16;
+
+	// Batched sprites have no vertex attributes, the quad corner comes from gl_VertexID
+	glCreateVertexArrays(1, &renderer->batch_vao);
+
+	renderer_create_queue(renderer);
+
 	return renderer;
 }
 
-void renderer_draw_sprite(Renderer *renderer, OpenGLTexture *texture, vec2 position, vec2 size, float rotate, vec3 color) {
-	opengl_shader_activate(renderer->shader);
+Renderer *renderer_create_software(Arena *arena, uint32_t width, uint32_t height) {
+	Renderer *renderer = arena_push_type(arena, Renderer);
+	*renderer = (Renderer){ 0 };
+	renderer->backend = RENDERER_BACKEND_SOFTWARE;
+	renderer->software = software_renderer_create(arena, width, height);
+
+	renderer_create_queue(renderer);
+
+	return renderer;
+}
+
+void renderer_destroy(Renderer *renderer) {
+	arena_free(renderer->frame_arena);
+	renderer->frame_arena = NULL;
+	renderer->queue = NULL;
+	if (renderer->backend == RENDERER_BACKEND_SOFTWARE)
+		return;
+
+	opengl_ring_buffer_destroy(renderer->stream);
+	glDeleteVertexArrays(1, &renderer->quad_vao);
+	glDeleteVertexArrays(1, &renderer->batch_vao);
+	glDeleteBuffers(1, &renderer->quad_vbo);
+}
+
+RendererBackend renderer_backend(const Renderer *renderer) {
+	return renderer->backend;
+}
+
+void renderer_set_software_filter(Renderer *renderer, SoftwareFilter filter) {
+	if (renderer->software)
+		software_renderer_set_filter(renderer->software, filter);
+}
+
+void renderer_set_shader(Renderer *renderer, OpenGLShader *shader) {
+	renderer->shader = shader;
+}
+
+void renderer_set_layer(Renderer *renderer, uint8_t layer) {
+	renderer->layer = layer;
+}
+
+void renderer_set_frame(Renderer *renderer, mat4 projection, vec2 screen_size, float time) {
+	glm_mat4_copy(projection, renderer->frame.projection);
+	renderer->frame.screen_size[0] = screen_size[0];
+	renderer->frame.screen_size[1] = screen_size[1];
+	renderer->frame.time = time;
+}
+
+static void renderer_push_frame(Renderer *renderer) {
+	size_t offset;
+	FrameData *frame = opengl_ring_buffer_push(renderer->stream, sizeof(FrameData), renderer->uniform_alignment, &offset);
+	if (frame) {
+		*frame = renderer->frame;
+		glBindBufferRange(GL_UNIFORM_BUFFER, RENDERER_FRAME_BINDING, opengl_ring_buffer_id(renderer->stream), offset, sizeof(FrameData));
+	}
+	renderer->frame_generation = opengl_ring_buffer_generation(renderer->stream);
+}
+
+void renderer_begin(Renderer *renderer) {
+	if (renderer->stream) {
+		opengl_ring_buffer_begin_frame(renderer->stream);
+		renderer_push_frame(renderer);
+	}
+
+	renderer->sprite_count = 0;
+	renderer->sprite_capacity = 0;
+	renderer->batch_shader = NULL;
+	renderer->batch_texture = NULL;
+	renderer->stats = (RendererStats){ 0 };
+
+	arena_set(renderer->frame_arena, renderer->frame_base);
+	render_queue_reset(renderer->queue);
+	renderer->layer = 0;
+	renderer->depth = 0;
+}
+
+void renderer_submit_sprite(Renderer *renderer, TextureRegion *region, vec2 position, vec2 size, float rotate, vec3 color) {
+	// An evicted texture is reloaded here, before its id goes into the sort key
+	texture_residency_touch(region->texture);
+
+	RenderCommand *command = render_queue_push(renderer->queue);
+	if (command == NULL) {
+		renderer_flush(renderer);
+		command = render_queue_push(renderer->queue);
+	}
+
+	// Depth is the submission index, so equal layer/shader/texture runs keep painter's order
+	*command = (RenderCommand){
+		.key = render_queue_key(renderer->layer, renderer->shader ? opengl_shader_id(renderer->shader) : 0, region->texture->id, renderer->depth++),
+		.shader = renderer->shader,
+		.region = region,
+		.position = { position[0], position[1] },
+		.size = { size[0], size[1] },
+		.rotation = rotate,
+		.color = { color[0], color[1], color[2] },
+	};
+}
+
+static void renderer_flush_batch(Renderer *renderer);
 
-	mat4 model;
-	glm_mat4_identity(model);
-	glm_translate(model, (float[3]){ position[0], position[1], 0.0f });
+static void renderer_batch_sprite(Renderer *renderer, OpenGLShader *shader, TextureRegion *region, const Affine2D *transform, const float *color) {
+	OpenGLTexture *texture = region->texture;
+	if (renderer->sprite_count > 0 && (renderer->batch_texture != texture || renderer->batch_shader != shader))
+		renderer_flush_batch(renderer);
+	if (renderer->sprite_count == renderer->sprite_capacity)
+		renderer_flush_batch(renderer);
 
-	glm_translate(model, (vec3){ size[0] * 0.5f, size[1] * 0.5f, 0.0f });
-	glm_rotate(model, glm_rad(rotate), (vec3){ 0.0f, 0.0f, 1.0f });
-	glm_translate(model, (vec3){ size[0] * -0.5f, size[1] * -0.5f, 0.0f });
+	if (renderer->sprite_count == 0) {
+		// Sprite data is written straight into the mapped stream buffer
+		size_t available;
+		renderer->sprites = opengl_ring_buffer_reserve(renderer->stream,
+			sizeof(SpriteData), RENDERER_MAX_BATCH_SPRITES * sizeof(SpriteData),
+			renderer->storage_alignment, &renderer->sprite_offset, &available);
+		if (renderer->sprites && opengl_ring_buffer_generation(renderer->stream) != renderer->frame_generation) {
+			// The reservation overflowed and fenced the region holding the frame block, later draws
+			// read a copy in the new region. The frame block takes the head, so reserve again after it.
+			renderer_push_frame(renderer);
+			renderer->sprites = opengl_ring_buffer_reserve(renderer->stream,
+				sizeof(SpriteData), RENDERER_MAX_BATCH_SPRITES * sizeof(SpriteData),
+				renderer->storage_alignment, &renderer->sprite_offset, &available);
+		}
+		if (renderer->sprites == NULL)
+			return;
 
-	glm_scale(model, (vec3){ size[0], size[1], 0.0f });
+		renderer->sprite_capacity = available / sizeof(SpriteData);
+	}
 
-	opengl_shader_set4fm(renderer->shader, "u_model", *model);
-	opengl_shader_set3fv(renderer->shader, "u_color", color);
+	renderer->batch_texture = texture;
+	renderer->batch_shader = shader;
 
+	renderer->sprites[renderer->sprite_count++] = (SpriteData){
+		.transform = *transform,
+		.uv = { region->uv[0], region->uv[1], region->uv[2], region->uv[3] },
+		.color = { color[0], color[1], color[2], (float)region->layer },
+	};
+}
+
+void renderer_flush(Renderer *renderer) {
+	uint32_t count = render_queue_count(renderer->queue);
+	if (count == 0)
+		return;
+
+	size_t mark = arena_size(renderer->frame_arena);
+	uint32_t *order = render_queue_sort(renderer->queue, renderer->frame_arena);
+
+	if (renderer->backend == RENDERER_BACKEND_SOFTWARE) {
+		for (uint32_t i = 0; i < count; i++) {
+			const RenderCommand *command = render_queue_command(renderer->queue, order[i]);
+			software_renderer_draw_quad(renderer->software, command->region->texture, command->region->uv, command->position, command->size, command->rotation, command->color);
+		}
+		renderer->stats.batch_count++;
+		renderer->stats.vertex_count += count * RENDERER_VERTICES_PER_SPRITE;
+	} else {
+		float *x = arena_push_array(renderer->frame_arena, float, RENDERER_TRANSFORM_CHUNK);
+		float *y = arena_push_array(renderer->frame_arena, float, RENDERER_TRANSFORM_CHUNK);
+		float *width = arena_push_array(renderer->frame_arena, float, RENDERER_TRANSFORM_CHUNK);
+		float *height = arena_push_array(renderer->frame_arena, float, RENDERER_TRANSFORM_CHUNK);
+		float *rotation = arena_push_array(renderer->frame_arena, float, RENDERER_TRANSFORM_CHUNK);
+		Affine2D *transforms = arena_push_array(renderer->frame_arena, Affine2D, RENDERER_TRANSFORM_CHUNK);
+
+		for (uint32_t base = 0; base < count; base += RENDERER_TRANSFORM_CHUNK) {
+			uint32_t chunk = count - base < RENDERER_TRANSFORM_CHUNK ? count - base : RENDERER_TRANSFORM_CHUNK;
+			for (uint32_t i = 0; i < chunk; i++) {
+				const RenderCommand *command = render_queue_command(renderer->queue, order[base + i]);
+				x[i] = command->position[0];
+				y[i] = command->position[1];
+				width[i] = command->size[0];
+				height[i] = command->size[1];
+				rotation[i] = command->rotation;
+			}
+
+			transform_batch_affine(x, y, width, height, rotation, chunk, transforms);
+
+			for (uint32_t i = 0; i < chunk; i++) {
+				const RenderCommand *command = render_queue_command(renderer->queue, order[base + i]);
+				renderer_batch_sprite(renderer, command->shader, command->region, &transforms[i], command->color);
+			}
+		}
+		renderer_flush_batch(renderer);
+	}
+
+	renderer->stats.command_count += count;
+
+	arena_set(renderer->frame_arena, mark);
+	render_queue_reset(renderer->queue);
+}
+
+static void renderer_flush_batch(Renderer *renderer) {
+	if (renderer->sprite_count == 0)
+		return;
+
+	size_t size = renderer->sprite_count * sizeof(SpriteData);
+	opengl_ring_buffer_commit(renderer->stream, size);
+
+	opengl_shader_activate(renderer->batch_shader);
+	opengl_texture_activate(renderer->batch_texture, 0);
+
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, RENDERER_SPRITE_BINDING, opengl_ring_buffer_id(renderer->stream), renderer->sprite_offset, size);
+	opengl_state_bind_vertex_array(renderer->batch_vao);
+	glDrawArraysInstanced(GL_TRIANGLES, 0, RENDERER_VERTICES_PER_SPRITE, renderer->sprite_count);
+
+	renderer->stats.batch_count++;
+	renderer->stats.vertex_count += renderer->sprite_count * RENDERER_VERTICES_PER_SPRITE;
+
+	renderer->sprite_count = 0;
+	renderer->sprite_capacity = 0;
+}
+
+static void sprite_instance_from_sprite(SpriteInstance *instance, const Sprite *sprite) {
+	// Destroyed sprites collapse to a zero-sized quad so the instance count never changes
+	float scale = sprite->is_destroyed ? 0.0f : 1.0f;
+	*instance = (SpriteInstance){
+		.rect = { sprite->position[0], sprite->position[1], sprite->size[0] * scale, sprite->size[1] * scale },
+		.uv = { sprite->texture->uv[0], sprite->texture->uv[1], sprite->texture->uv[2], sprite->texture->uv[3] },
+		.color = { sprite->color[0], sprite->color[1], sprite->color[2] },
+		.rotation = sprite->rotation,
+		.layer = (float)sprite->texture->layer,
+	};
+}
+
+InstanceLayer *renderer_create_instance_layer(Renderer *renderer, Arena *arena, OpenGLShader *shader, const Sprite *sprites, uint32_t count) {
+	InstanceLayer *layer = arena_push_type(arena, InstanceLayer);
+	*layer = (InstanceLayer){
+		.shader = shader,
+		.region = count ? sprites[0].texture : NULL,
+		.instances = arena_push_array(arena, SpriteInstance, count),
+		.count = count,
+	};
+
+	for (uint32_t i = 0; i < count; i++)
+		sprite_instance_from_sprite(&layer->instances[i], &sprites[i]);
+
+	if (renderer->backend == RENDERER_BACKEND_SOFTWARE)
+		return layer;
+
+	glCreateBuffers(1, &layer->buffer);
+	glNamedBufferStorage(layer->buffer, (count ? count : 1) * sizeof(SpriteInstance), count ? layer->instances : NULL, GL_DYNAMIC_STORAGE_BIT);
+
+	return layer;
+}
+
+void renderer_update_instance(InstanceLayer *layer, uint32_t index, const Sprite *sprite) {
+	if (index >= layer->count)
+		return;
+
+	sprite_instance_from_sprite(&layer->instances[index], sprite);
+
+	if (layer->dirty_begin == layer->dirty_end) {
+		layer->dirty_begin = index;
+		layer->dirty_end = index + 1;
+	} else {
+		layer->dirty_begin = index < layer->dirty_begin ? index : layer->dirty_begin;
+		layer->dirty_end = index + 1 > layer->dirty_end ? index + 1 : layer->dirty_end;
+	}
+}
+
+void renderer_destroy_instance_layer(InstanceLayer *layer) {
+	if (layer->buffer)
+		glDeleteBuffers(1, &layer->buffer);
+	layer->buffer = 0;
+	layer->count = 0;
+}
+
+void renderer_draw_instance_layer(Renderer *renderer, InstanceLayer *layer) {
+	if (layer->count == 0)
+		return;
+
+	// Keep submission order with anything batched before the layer
+	renderer_flush(renderer);
+	OpenGLTexture *texture = layer->region->texture;
+	texture_residency_touch(texture);
+
+	if (renderer->backend == RENDERER_BACKEND_SOFTWARE) {
+		for (uint32_t i = 0; i < layer->count; i++) {
+			SpriteInstance *instance = &layer->instances[i];
+			software_renderer_draw_quad(renderer->software, texture, instance->uv, instance->rect, instance->rect + 2, instance->rotation, instance->color);
+		}
+		layer->dirty_begin = layer->dirty_end = 0;
+
+		renderer->stats.batch_count++;
+		renderer->stats.vertex_count += 6;
+		renderer->stats.instance_count += layer->count;
+		return;
+	}
+
+	if (layer->dirty_begin != layer->dirty_end) {
+		glNamedBufferSubData(layer->buffer, layer->dirty_begin * sizeof(SpriteInstance), (layer->dirty_end - layer->dirty_begin) * sizeof(SpriteInstance), layer->instances + layer->dirty_begin);
+		layer->dirty_begin = layer->dirty_end = 0;
+	}
+
+	opengl_shader_activate(layer->shader);
 	opengl_texture_activate(texture, 0);
 
-	glBindVertexArray(renderer->quad_vao);
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-	glBindVertexArray(0);
+	glVertexArrayVertexBuffer(renderer->quad_vao, 1, layer->buffer, 0, sizeof(SpriteInstance));
+	opengl_state_bind_vertex_array(renderer->quad_vao);
+	glDrawArraysInstanced(GL_TRIANGLES, 0, 6, layer->count);
+
+	renderer->stats.batch_count++;
+	renderer->stats.vertex_count += 6;
+	renderer->stats.instance_count += layer->count;
+}
+
+RendererStats renderer_stats(const Renderer *renderer) {
+	return renderer->stats;
+}
+
+OpenGLRingBufferStats renderer_stream_stats(const Renderer *renderer) {
+	if (renderer->stream == NULL)
+		return (OpenGLRingBufferStats){ 0 };
+	return opengl_ring_buffer_stats(renderer->stream);
+}
+
+void renderer_begin_pass(Renderer *renderer, ProfilerPass pass) {
+	renderer_flush(renderer);
+	profiler_begin_pass(pass);
+}
+
+void renderer_end_pass(Renderer *renderer, ProfilerPass pass) {
+	renderer_flush(renderer);
+	profiler_end_pass(pass);
+}
+
+void renderer_clear(Renderer *renderer, vec4 color) {
+	if (renderer->backend == RENDERER_BACKEND_SOFTWARE) {
+		software_renderer_clear(renderer->software, color);
+		return;
+	}
+	glClearColor(color[0], color[1], color[2], color[3]);
+	glClear(GL_COLOR_BUFFER_BIT);
+}
+
+bool renderer_dump_frame(Renderer *renderer, uint32_t width, uint32_t height, const char *path) {
+	uint8_t *pixels = NULL;
+	const uint8_t *rows;
+	if (renderer->backend == RENDERER_BACKEND_SOFTWARE) {
+		width = software_renderer_width(renderer->software);
+		height = software_renderer_height(renderer->software);
+		rows = software_renderer_pixels(renderer->software);
+	} else {
+		if ((pixels = malloc((size_t)width * height * 4)) == NULL)
+			return false;
+		renderer_flush(renderer);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		rows = pixels;
+	}
+
+	FILE *file = fopen(path, "wb");
+	if (file == NULL) {
+		free(pixels);
+		return false;
+	}
+
+	// Binary PPM, top row first. GL reads bottom-up so its rows are written in reverse.
+	fprintf(file, "P6\n%u %u\n255\n", width, height);
+	for (uint32_t y = 0; y < height; y++) {
+		uint32_t row = renderer->backend == RENDERER_BACKEND_SOFTWARE ? y : height - 1 - y;
+		const uint8_t *pixel = rows + (size_t)row * width * 4;
+		for (uint32_t x = 0; x < width; x++, pixel += 4)
+			fwrite(pixel, 1, 3, file);
+	}
+
+	bool success = ferror(file) == 0;
+	fclose(file);
+	free(pixels);
+	return success;
+}
+
+void renderer_draw_sprite(Renderer *renderer, TextureRegion *texture, vec2 position, vec2 size, float rotate, vec3 color) {
+	renderer_submit_sprite(renderer, texture, position, size, rotate, color);
+	renderer_flush(renderer);
 }
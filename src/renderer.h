@@ -1,14 +1,80 @@
 #pragma once
 
+#include "profiler.h"
+#include "ring_buffer.h"
+#include "software_renderer.h"
+
 #include <cglm/cglm.h>
 
 typedef struct _arena Arena;
 
 typedef struct _gl_texture OpenGLTexture;
+typedef struct _texture_region TextureRegion;
 typedef struct _gl_shader OpenGLShader;
 
+typedef struct sprite Sprite;
+
 typedef struct _renderer Renderer;
+typedef struct _instance_layer InstanceLayer;
+
+typedef enum {
+	RENDERER_BACKEND_OPENGL,
+	// CPU rasterizer for machines without a GPU, needs headless textures and no GL context
+	RENDERER_BACKEND_SOFTWARE,
+} RendererBackend;
+
+typedef struct {
+	uint32_t batch_count;
+	uint32_t vertex_count;
+	uint32_t instance_count;
+	uint32_t command_count;
+} RendererStats;
 
 Renderer *renderer_create(Arena *arena, OpenGLShader *shader);
+Renderer *renderer_create_software(Arena *arena, uint32_t width, uint32_t height);
+// Deletes the GL objects and the command queue, the renderer stays in the arena it was created from
+void renderer_destroy(Renderer *renderer);
+RendererBackend renderer_backend(const Renderer *renderer);
+void renderer_set_software_filter(Renderer *renderer, SoftwareFilter filter);
+// Shader and layer apply to sprites submitted after the call. Lower layers draw first.
+void renderer_set_shader(Renderer *renderer, OpenGLShader *shader);
+void renderer_set_layer(Renderer *renderer, uint8_t layer);
+
+// Per-frame values read by every shader from the std140 Frame block, uploaded by the next renderer_begin
+void renderer_set_frame(Renderer *renderer, mat4 projection, vec2 screen_size, float time);
+
+// Sprites submitted between begin and flush are recorded as commands keyed by layer, shader,
+// texture and submission order. Flush radix-sorts them and draws one batch per run of equal
+// texture and shader, so order within a layer is only kept between sprites of the same batch.
+// A batch is one std430 Sprites range in the stream buffer and one instanced draw.
+// Regions of the same atlas page share a texture, so they batch together. In texture array mode
+// every page is a layer of one texture and the whole atlas batches together.
+void renderer_begin(Renderer *renderer);
+void renderer_submit_sprite(Renderer *renderer, TextureRegion *texture, vec2 position, vec2 size, float rotate, vec3 color);
+void renderer_flush(Renderer *renderer);
+
+// Static sprites kept in a GPU instance buffer and drawn with one instanced call
+// over the unit quad. Only instances changed through renderer_update_instance are
+// re-uploaded, on the next draw. The whole layer binds the texture of the first sprite's region,
+// looked up on every draw, which is its atlas page or the whole atlas in texture array mode.
+// The region has to outlive the layer.
+InstanceLayer *renderer_create_instance_layer(Renderer *renderer, Arena *arena, OpenGLShader *shader, const Sprite *sprites, uint32_t count);
+void renderer_update_instance(InstanceLayer *layer, uint32_t index, const Sprite *sprite);
+// Deletes the instance buffer, the instances stay in the arena the layer was created from
+void renderer_destroy_instance_layer(InstanceLayer *layer);
+void renderer_draw_instance_layer(Renderer *renderer, InstanceLayer *layer);
+
+// Batches and vertices drawn since the last renderer_begin.
+RendererStats renderer_stats(const Renderer *renderer);
+// Fence waits and overflows of the stream buffer, for sizing RENDERER_STREAM_REGIONS
+OpenGLRingBufferStats renderer_stream_stats(const Renderer *renderer);
+
+// Flushes pending sprites on both ends so the pass timing covers exactly the work submitted inside it
+void renderer_begin_pass(Renderer *renderer, ProfilerPass pass);
+void renderer_end_pass(Renderer *renderer, ProfilerPass pass);
+
+void renderer_clear(Renderer *renderer, vec4 color);
+// Writes the current framebuffer as a binary PPM. width and height are only used by the GL backend.
+bool renderer_dump_frame(Renderer *renderer, uint32_t width, uint32_t height, const char *path);
 
-void renderer_draw_sprite(Renderer* renderer, OpenGLTexture *texture, vec2 position, vec2 size, float rotate, vec3 color);
+void renderer_draw_sprite(Renderer* renderer, TextureRegion *texture, vec2 position, vec2 size, float rotate, vec3 color);
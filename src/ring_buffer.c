@@ -0,0 +1,160 @@
+#include "ring_buffer.h"
+
+#include "core/arena.h"
+#include "core/clock.h"
+#include "core/logger.h"
+
+#include <glad/gl.h>
+
+#define RING_BUFFER_MAX_REGIONS 8
+
+struct _gl_ring_buffer {
+	uint32_t id;
+	uint8_t *mapping;
+
+	size_t region_size;
+	uint32_t region_count, region;
+	size_t head, reserved;
+	uint32_t generation;
+
+	GLsync fences[RING_BUFFER_MAX_REGIONS];
+
+	OpenGLRingBufferStats stats;
+};
+
+static void ring_buffer_wait(OpenGLRingBuffer *ring, uint32_t region) {
+	GLsync fence = ring->fences[region];
+	if (fence == NULL)
+		return;
+
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED) {
+		uint64_t start = clock_now_ns();
+		do {
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		} while (result == GL_TIMEOUT_EXPIRED);
+		uint64_t elapsed = clock_now_ns() - start;
+
+		ring->stats.wait_count++;
+		ring->stats.wait_time_ns += elapsed;
+		ring->stats.frame_wait_time_ns += elapsed;
+		if (elapsed > ring->stats.max_wait_time_ns)
+			ring->stats.max_wait_time_ns = elapsed;
+	}
+	if (result == GL_WAIT_FAILED)
+		LOG_ERROR("RING_BUFFER: glClientWaitSync failed on region %d", region);
+
+	glDeleteSync(fence);
+	ring->fences[region] = NULL;
+}
+
+static void ring_buffer_advance(OpenGLRingBuffer *ring) {
+	if (ring->head > ring->stats.high_water)
+		ring->stats.high_water = ring->head;
+
+	if (ring->head > 0) {
+		ring->fences[ring->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		ring->region = (ring->region + 1) % ring->region_count;
+		ring->generation++;
+	}
+	ring->head = 0;
+	ring->reserved = 0;
+
+	ring_buffer_wait(ring, ring->region);
+}
+
+OpenGLRingBuffer *opengl_ring_buffer_create(Arena *arena, size_t region_size, uint32_t region_count) {
+	if (region_count == 0 || region_count > RING_BUFFER_MAX_REGIONS) {
+		LOG_WARN("RING_BUFFER: region count %d clamped to [1, %d]", region_count, RING_BUFFER_MAX_REGIONS);
+		region_count = region_count == 0 ? 1 : RING_BUFFER_MAX_REGIONS;
+	}
+
+	OpenGLRingBuffer *ring = arena_push_type(arena, OpenGLRingBuffer);
+	*ring = (OpenGLRingBuffer){
+		.region_size = region_size,
+		.region_count = region_count,
+	};
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &ring->id);
+	glNamedBufferStorage(ring->id, region_size * region_count, NULL, flags);
+	ring->mapping = glMapNamedBufferRange(ring->id, 0, region_size * region_count, flags);
+	if (ring->mapping == NULL)
+		LOG_ERROR("RING_BUFFER: Failed to map %zu bytes", region_size * region_count);
+
+	return ring;
+}
+
+void opengl_ring_buffer_destroy(OpenGLRingBuffer *ring) {
+	for (uint32_t i = 0; i < ring->region_count; i++) {
+		if (ring->fences[i])
+			glDeleteSync(ring->fences[i]);
+		ring->fences[i] = NULL;
+	}
+	glUnmapNamedBuffer(ring->id);
+	glDeleteBuffers(1, &ring->id);
+	ring->mapping = NULL;
+}
+
+void opengl_ring_buffer_begin_frame(OpenGLRingBuffer *ring) {
+	ring->stats.frame_wait_time_ns = 0;
+	ring_buffer_advance(ring);
+}
+
+static size_t align_up(size_t value, size_t alignment) {
+	return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+void *opengl_ring_buffer_reserve(OpenGLRingBuffer *ring, size_t min_size, size_t max_size, size_t alignment, size_t *offset, size_t *available) {
+	size_t base = ring->region * ring->region_size;
+	size_t head = align_up(base + ring->head, alignment) - base;
+
+	if (head + min_size > ring->region_size) {
+		ring->stats.overflow_count++;
+		ring_buffer_advance(ring);
+
+		base = ring->region * ring->region_size;
+		head = align_up(base, alignment) - base;
+		if (head + min_size > ring->region_size) {
+			LOG_ERROR("RING_BUFFER: Reservation of %zu bytes exceeds region size %zu", min_size, ring->region_size);
+			return NULL;
+		}
+	}
+
+	size_t free_size = ring->region_size - head;
+	ring->head = head;
+	ring->reserved = free_size < max_size ? free_size : max_size;
+
+	*offset = base + head;
+	if (available)
+		*available = ring->reserved;
+	return ring->mapping + base + head;
+}
+
+void opengl_ring_buffer_commit(OpenGLRingBuffer *ring, size_t size) {
+	if (size > ring->reserved) {
+		LOG_ERROR("RING_BUFFER: Committed %zu bytes with only %zu reserved", size, ring->reserved);
+		size = ring->reserved;
+	}
+	ring->head += size;
+	ring->reserved = 0;
+}
+
+void *opengl_ring_buffer_push(OpenGLRingBuffer *ring, size_t size, size_t alignment, size_t *offset) {
+	void *result = opengl_ring_buffer_reserve(ring, size, size, alignment, offset, NULL);
+	if (result)
+		opengl_ring_buffer_commit(ring, size);
+	return result;
+}
+
+uint32_t opengl_ring_buffer_generation(const OpenGLRingBuffer *ring) {
+	return ring->generation;
+}
+
+uint32_t opengl_ring_buffer_id(const OpenGLRingBuffer *ring) {
+	return ring->id;
+}
+
+OpenGLRingBufferStats opengl_ring_buffer_stats(const OpenGLRingBuffer *ring) {
+	return ring->stats;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct _arena Arena;
+typedef struct _gl_ring_buffer OpenGLRingBuffer;
+
+typedef struct {
+	// Time spent blocked in glClientWaitSync waiting for the GPU to release a region
+	uint64_t wait_time_ns, max_wait_time_ns, frame_wait_time_ns;
+	uint32_t wait_count;
+	// Regions that ran out of space mid-frame and forced an early advance
+	uint32_t overflow_count;
+	// Largest number of bytes written to a single region
+	size_t high_water;
+} OpenGLRingBufferStats;
+
+// One persistently mapped, coherent buffer split into region_count regions of region_size bytes.
+// Each frame writes into its own region, which is fenced when the next frame begins, so the CPU
+// only waits when it catches up to a region the GPU is still reading.
+OpenGLRingBuffer *opengl_ring_buffer_create(Arena *arena, size_t region_size, uint32_t region_count);
+void opengl_ring_buffer_destroy(OpenGLRingBuffer *ring);
+
+void opengl_ring_buffer_begin_frame(OpenGLRingBuffer *ring);
+
+// Returns a pointer into mapped memory with at least min_size and up to max_size bytes available,
+// aligned to alignment within the buffer. Nothing is consumed until opengl_ring_buffer_commit.
+void *opengl_ring_buffer_reserve(OpenGLRingBuffer *ring, size_t min_size, size_t max_size, size_t alignment, size_t *offset, size_t *available);
+void opengl_ring_buffer_commit(OpenGLRingBuffer *ring, size_t size);
+// reserve + commit of exactly size bytes
+void *opengl_ring_buffer_push(OpenGLRingBuffer *ring, size_t size, size_t alignment, size_t *offset);
+
+// Bumped every time writing moves on to the next region, including an overflow in
+// opengl_ring_buffer_reserve. Whatever stays bound across draws has to be pushed again into the
+// new region, the old one is fenced and may be rewritten before those draws complete.
+uint32_t opengl_ring_buffer_generation(const OpenGLRingBuffer *ring);
+
+uint32_t opengl_ring_buffer_id(const OpenGLRingBuffer *ring);
+OpenGLRingBufferStats opengl_ring_buffer_stats(const OpenGLRingBuffer *ring);
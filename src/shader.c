@@ -2,64 +2,399 @@
 
 #include "core/arena.h"
 #include "core/logger.h"
+#include "gl_state.h"
+#include "shader_cache.h"
 
 #include <glad/gl.h>
 #include <string.h>
 
+#define SHADER_UNIFORM_NAME_LENGTH 64
+
+typedef char UniformName[SHADER_UNIFORM_NAME_LENGTH];
+
+typedef enum {
+	UNIFORM_VALUE_NONE,
+	UNIFORM_VALUE_INT,
+	UNIFORM_VALUE_FLOAT,
+	UNIFORM_VALUE_VEC2,
+	UNIFORM_VALUE_VEC3,
+	UNIFORM_VALUE_VEC4,
+	UNIFORM_VALUE_MAT4,
+} UniformValueKind;
+
+typedef struct {
+	uint32_t hash;
+	int32_t location;
+	uint32_t type;
+	int32_t size;
+
+	// Last value set through the table, restored after a reload
+	UniformValueKind kind;
+	union {
+		int32_t i;
+		float f[16];
+	} value;
+} ShaderUniform;
+
+#define SHADER_STAGE_COUNT 2
+#define SHADER_LOG_LENGTH 2048
+
+static const uint32_t g_stage_types[SHADER_STAGE_COUNT] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+static const char *g_stage_names[SHADER_STAGE_COUNT] = { "Vertex", "Fragment" };
+
+// A program whose compile and link were submitted but not yet checked.
+// stages are zero when the binary came from the shader cache.
+typedef struct {
+	uint32_t program;
+	uint32_t stages[SHADER_STAGE_COUNT];
+	uint64_t cache_key;
+} ShaderBuild;
+
 struct _gl_shader {
 	uint32_t program;
+	OpenGLShaderStatus status;
+	ShaderBuild build;
+	// Uniforms are reflected into this arena once the build completes
+	Arena *arena;
+
+	uint32_t uniform_count, uniform_capacity;
+	ShaderUniform *uniforms;
+	UniformName *uniform_names;
 };
 
-OpenGLShader *opengl_shader_create(Arena *arena, const char *vertex_shader_source, const char *fragment_shader_source) {
-	uint32_t vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertex_shader, 1, &vertex_shader_source, NULL);
-	glCompileShader(vertex_shader);
+static uint32_t uniform_hash(const char *name) {
+	uint32_t hash = 2166136261u;
+	for (; *name; name++)
+		hash = (hash ^ (uint8_t)*name) * 16777619u;
+	return hash;
+}
+
+// Entries keep their index across reloads so handles stay valid, uniforms the new
+// program no longer has are left with location -1.
+static void shader_reflect_uniforms(Arena *arena, OpenGLShader *shader) {
+	int32_t active_count = 0;
+	glGetProgramiv(shader->program, GL_ACTIVE_UNIFORMS, &active_count);
+
+	for (uint32_t i = 0; i < shader->uniform_count; i++)
+		shader->uniforms[i].location = -1;
+
+	uint32_t capacity = shader->uniform_count + active_count;
+	if (capacity > shader->uniform_capacity) {
+		ShaderUniform *uniforms = arena_push_array(arena, ShaderUniform, capacity);
+		UniformName *uniform_names = arena_push_array(arena, UniformName, capacity);
+		if (shader->uniform_count) {
+			memcpy(uniforms, shader->uniforms, shader->uniform_count * sizeof(*uniforms));
+			memcpy(uniform_names, shader->uniform_names, shader->uniform_count * sizeof(*uniform_names));
+		}
+		shader->uniforms = uniforms;
+		shader->uniform_names = uniform_names;
+		shader->uniform_capacity = capacity;
+	}
+
+	for (int32_t i = 0; i < active_count; i++) {
+		UniformName name;
+		int32_t length = 0, size = 0;
+		uint32_t type = 0;
+		glGetActiveUniform(shader->program, i, sizeof(name), &length, &size, &type, name);
+
+		// Members of uniform blocks have no location and are not set through this table
+		int32_t location = glGetUniformLocation(shader->program, name);
+		if (location == -1)
+			continue;
+
+		if (length == (int32_t)sizeof(name) - 1)
+			LOG_WARN("SHADER: Uniform name '%s' truncated to %d characters", name, length);
+
+		// Arrays are reported as "name[0]", look them up by their base name
+		char *bracket = strchr(name, '[');
+		if (bracket)
+			*bracket = '\0';
 
-	uint32_t fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragment_shader, 1, &fragment_shader_source, NULL);
-	glCompileShader(fragment_shader);
+		uint32_t index = opengl_shader_uniform_handle(shader, name);
+		if (index == OPENGL_SHADER_INVALID_UNIFORM) {
+			index = shader->uniform_count++;
+			shader->uniforms[index] = (ShaderUniform){ .hash = uniform_hash(name) };
+			memcpy(shader->uniform_names[index], name, sizeof(name));
+		}
 
-	uint32_t program = glCreateProgram();
-	glAttachShader(program, vertex_shader);
-	glAttachShader(program, fragment_shader);
-	glLinkProgram(program);
+		shader->uniforms[index].location = location;
+		shader->uniforms[index].type = type;
+		shader->uniforms[index].size = size;
+	}
+}
+
+static void shader_restore_uniforms(const OpenGLShader *shader) {
+	for (uint32_t i = 0; i < shader->uniform_count; i++) {
+		const ShaderUniform *uniform = &shader->uniforms[i];
+		if (uniform->location == -1)
+			continue;
+
+		switch (uniform->kind) {
+			case UNIFORM_VALUE_NONE:
+				break;
+			case UNIFORM_VALUE_INT:
+				glProgramUniform1i(shader->program, uniform->location, uniform->value.i);
+				break;
+			case UNIFORM_VALUE_FLOAT:
+				glProgramUniform1f(shader->program, uniform->location, uniform->value.f[0]);
+				break;
+			case UNIFORM_VALUE_VEC2:
+				glProgramUniform2fv(shader->program, uniform->location, 1, uniform->value.f);
+				break;
+			case UNIFORM_VALUE_VEC3:
+				glProgramUniform3fv(shader->program, uniform->location, 1, uniform->value.f);
+				break;
+			case UNIFORM_VALUE_VEC4:
+				glProgramUniform4fv(shader->program, uniform->location, 1, uniform->value.f);
+				break;
+			case UNIFORM_VALUE_MAT4:
+				glProgramUniformMatrix4fv(shader->program, uniform->location, 1, GL_FALSE, uniform->value.f);
+				break;
+		}
+	}
+}
+
+static void shader_build_begin(ShaderBuild *build, const char *vertex_shader_source, const char *fragment_shader_source) {
+	static bool parallel_compile_configured = false;
+	if (!parallel_compile_configured && GLAD_GL_KHR_parallel_shader_compile) {
+		// Let the driver pick its own thread count
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+		parallel_compile_configured = true;
+	}
+
+	*build = (ShaderBuild){
+		.program = glCreateProgram(),
+		.cache_key = shader_cache_key(vertex_shader_source, fragment_shader_source),
+	};
+	if (shader_cache_load(build->program, build->cache_key))
+		return;
+
+	// No status queries here, they would wait for the driver to finish
+	const char *sources[SHADER_STAGE_COUNT] = { vertex_shader_source, fragment_shader_source };
+	for (uint32_t i = 0; i < SHADER_STAGE_COUNT; i++) {
+		build->stages[i] = glCreateShader(g_stage_types[i]);
+		glShaderSource(build->stages[i], 1, &sources[i], NULL);
+		glCompileShader(build->stages[i]);
+		glAttachShader(build->program, build->stages[i]);
+	}
+
+	glProgramParameteri(build->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(build->program);
+}
 
-	glDetachShader(program, vertex_shader);
-	glDetachShader(program, fragment_shader);
-	glDeleteShader(vertex_shader);
-	glDeleteShader(fragment_shader);
+// Never blocks with GL_KHR_parallel_shader_compile, without it the build counts as complete
+// and shader_build_end waits instead
+static bool shader_build_complete(const ShaderBuild *build) {
+	if (build->stages[0] == 0 || !GLAD_GL_KHR_parallel_shader_compile)
+		return true;
 
+	int32_t complete = GL_FALSE;
+	glGetProgramiv(build->program, GL_COMPLETION_STATUS_KHR, &complete);
+	return complete == GL_TRUE;
+}
+
+// Checks and logs compile and link status, releases the stages and caches the binary.
+// Returns false and deletes the program when anything failed.
+static bool shader_build_end(ShaderBuild *build) {
+	if (build->stages[0] == 0)
+		return true;
+
+	bool success = true;
+	char log[SHADER_LOG_LENGTH];
+
+	for (uint32_t i = 0; i < SHADER_STAGE_COUNT; i++) {
+		int32_t compiled = GL_FALSE;
+		glGetShaderiv(build->stages[i], GL_COMPILE_STATUS, &compiled);
+		if (compiled != GL_TRUE) {
+			glGetShaderInfoLog(build->stages[i], sizeof(log), NULL, log);
+			LOG_ERROR("SHADER: %s stage failed to compile:\n%s", g_stage_names[i], log);
+			success = false;
+		}
+	}
+
+	int32_t linked = GL_FALSE;
+	glGetProgramiv(build->program, GL_LINK_STATUS, &linked);
+	if (success && linked != GL_TRUE) {
+		glGetProgramInfoLog(build->program, sizeof(log), NULL, log);
+		LOG_ERROR("SHADER: Program %u failed to link:\n%s", build->program, log);
+		success = false;
+	}
+
+	for (uint32_t i = 0; i < SHADER_STAGE_COUNT; i++) {
+		glDetachShader(build->program, build->stages[i]);
+		glDeleteShader(build->stages[i]);
+		build->stages[i] = 0;
+	}
+
+	if (!success) {
+		glDeleteProgram(build->program);
+		build->program = 0;
+		return false;
+	}
+
+	shader_cache_store(build->program, build->cache_key);
+	return true;
+}
+
+OpenGLShader *opengl_shader_submit(Arena *arena, const char *vertex_shader_source, const char *fragment_shader_source) {
 	OpenGLShader *shader = arena_push_type(arena, OpenGLShader);
 	*shader = (OpenGLShader){
-		.program = program
+		.status = OPENGL_SHADER_PENDING,
+		.arena = arena,
 	};
+	shader_build_begin(&shader->build, vertex_shader_source, fragment_shader_source);
 
 	return shader;
 }
 
-void opengl_shader_activate(const OpenGLShader *shader) {
-	glUseProgram(shader->program);
+static void shader_finish(OpenGLShader *shader) {
+	if (shader_build_end(&shader->build)) {
+		shader->program = shader->build.program;
+		shader->status = OPENGL_SHADER_READY;
+		shader_reflect_uniforms(shader->arena, shader);
+	} else {
+		shader->status = OPENGL_SHADER_FAILED;
+	}
+}
+
+OpenGLShaderStatus opengl_shader_poll(OpenGLShader *shader) {
+	if (shader->status == OPENGL_SHADER_PENDING && shader_build_complete(&shader->build))
+		shader_finish(shader);
+	return shader->status;
+}
+
+OpenGLShaderStatus opengl_shader_wait(OpenGLShader *shader) {
+	if (shader->status == OPENGL_SHADER_PENDING)
+		shader_finish(shader);
+	return shader->status;
+}
+
+OpenGLShader *opengl_shader_create(Arena *arena, const char *vertex_shader_source, const char *fragment_shader_source) {
+	OpenGLShader *shader = opengl_shader_submit(arena, vertex_shader_source, fragment_shader_source);
+	opengl_shader_wait(shader);
+	return shader;
+}
+
+bool opengl_shader_reload(OpenGLShader *shader, Arena *arena, const char *vertex_shader_source, const char *fragment_shader_source) {
+	opengl_shader_wait(shader);
+
+	ShaderBuild build;
+	shader_build_begin(&build, vertex_shader_source, fragment_shader_source);
+	if (!shader_build_end(&build)) {
+		LOG_ERROR("SHADER: Reload failed, keeping the previous program");
+		return false;
+	}
+
+	opengl_state_forget_program(shader->program);
+	glDeleteProgram(shader->program);
+	shader->program = build.program;
+	shader->status = OPENGL_SHADER_READY;
+
+	shader_reflect_uniforms(arena, shader);
+	shader_restore_uniforms(shader);
+
+	return true;
+}
+
+void opengl_shader_destroy(OpenGLShader *shader) {
+	// Stages are only left while the build is pending
+	for (uint32_t i = 0; i < SHADER_STAGE_COUNT; i++) {
+		if (shader->build.stages[i])
+			glDeleteShader(shader->build.stages[i]);
+		shader->build.stages[i] = 0;
+	}
+
+	uint32_t program = shader->status == OPENGL_SHADER_PENDING ? shader->build.program : shader->program;
+	opengl_state_forget_program(program);
+	glDeleteProgram(program);
+	shader->program = shader->build.program = 0;
+	shader->status = OPENGL_SHADER_FAILED;
+}
+
+void opengl_shader_activate(OpenGLShader *shader) {
+	opengl_shader_wait(shader);
+	opengl_state_use_program(shader->program);
 }
 void opengl_shader_deactivate(const OpenGLShader *shader) {
 	(void)shader;
-	glUseProgram(0);
+	opengl_state_use_program(0);
+}
+
+uint32_t opengl_shader_id(const OpenGLShader *shader) {
+	return shader->program;
+}
+
+UniformHandle opengl_shader_uniform_handle(OpenGLShader *shader, const char *name) {
+	opengl_shader_wait(shader);
+	uint32_t hash = uniform_hash(name);
+	for (uint32_t i = 0; i < shader->uniform_count; i++) {
+		if (shader->uniforms[i].hash == hash && strcmp(shader->uniform_names[i], name) == 0)
+			return i;
+	}
+	return OPENGL_SHADER_INVALID_UNIFORM;
+}
+
+static int32_t uniform_location(const OpenGLShader *shader, UniformHandle handle) {
+	return handle < shader->uniform_count ? shader->uniforms[handle].location : -1;
+}
+
+static ShaderUniform *shader_uniform_value(OpenGLShader *shader, UniformHandle handle, UniformValueKind kind) {
+	if (handle >= shader->uniform_count)
+		return NULL;
+	shader->uniforms[handle].kind = kind;
+	return &shader->uniforms[handle];
+}
+
+static void shader_uniform_store(OpenGLShader *shader, UniformHandle handle, UniformValueKind kind, const float *value, uint32_t count) {
+	ShaderUniform *uniform = shader_uniform_value(shader, handle, kind);
+	if (uniform)
+		memcpy(uniform->value.f, value, count * sizeof(float));
 }
 
 void opengl_shader_seti(OpenGLShader *shader, const char *name, int32_t value) {
-	glUniform1i(glGetUniformLocation(shader->program, name), value);
+	opengl_shader_seti_h(shader, opengl_shader_uniform_handle(shader, name), value);
 }
 void opengl_shader_setf(OpenGLShader *shader, const char *name, float value) {
-	glUniform1f(glGetUniformLocation(shader->program, name), value);
+	opengl_shader_setf_h(shader, opengl_shader_uniform_handle(shader, name), value);
 }
 void opengl_shader_set2fv(OpenGLShader *shader, const char *name, float *value) {
-	glUniform2fv(glGetUniformLocation(shader->program, name), 1, value);
+	opengl_shader_set2fv_h(shader, opengl_shader_uniform_handle(shader, name), value);
 }
 void opengl_shader_set3fv(OpenGLShader *shader, const char *name, float *value) {
-	glUniform3fv(glGetUniformLocation(shader->program, name), 1, value);
+	opengl_shader_set3fv_h(shader, opengl_shader_uniform_handle(shader, name), value);
 }
 void opengl_shader_set4fv(OpenGLShader *shader, const char *name, float *value) {
-	glUniform4fv(glGetUniformLocation(shader->program, name), 1, value);
+	opengl_shader_set4fv_h(shader, opengl_shader_uniform_handle(shader, name), value);
 }
 void opengl_shader_set4fm(OpenGLShader *shader, const char *name, float *value) {
-	glUniformMatrix4fv(glGetUniformLocation(shader->program, name), 1, GL_FALSE, value);
+	opengl_shader_set4fm_h(shader, opengl_shader_uniform_handle(shader, name), value);
+}
+
+void opengl_shader_seti_h(OpenGLShader *shader, UniformHandle handle, int32_t value) {
+	ShaderUniform *uniform = shader_uniform_value(shader, handle, UNIFORM_VALUE_INT);
+	if (uniform)
+		uniform->value.i = value;
+	glUniform1i(uniform_location(shader, handle), value);
+}
+void opengl_shader_setf_h(OpenGLShader *shader, UniformHandle handle, float value) {
+	ShaderUniform *uniform = shader_uniform_value(shader, handle, UNIFORM_VALUE_FLOAT);
+	if (uniform)
+		uniform->value.f[0] = value;
+	glUniform1f(uniform_location(shader, handle), value);
+}
+void opengl_shader_set2fv_h(OpenGLShader *shader, UniformHandle handle, float *value) {
+	shader_uniform_store(shader, handle, UNIFORM_VALUE_VEC2, value, 2);
+	glUniform2fv(uniform_location(shader, handle), 1, value);
+}
+void opengl_shader_set3fv_h(OpenGLShader *shader, UniformHandle handle, float *value) {
+	shader_uniform_store(shader, handle, UNIFORM_VALUE_VEC3, value, 3);
+	glUniform3fv(uniform_location(shader, handle), 1, value);
+}
+void opengl_shader_set4fv_h(OpenGLShader *shader, UniformHandle handle, float *value) {
+	shader_uniform_store(shader, handle, UNIFORM_VALUE_VEC4, value, 4);
+	glUniform4fv(uniform_location(shader, handle), 1, value);
+}
+void opengl_shader_set4fm_h(OpenGLShader *shader, UniformHandle handle, float *value) {
+	shader_uniform_store(shader, handle, UNIFORM_VALUE_MAT4, value, 16);
+	glUniformMatrix4fv(uniform_location(shader, handle), 1, GL_FALSE, value);
 }
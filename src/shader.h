@@ -1,14 +1,43 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 typedef struct _arena Arena;
 typedef struct _gl_shader OpenGLShader;
 
+// Index into the shader's reflected uniform table, resolved once with opengl_shader_uniform_handle
+typedef uint32_t UniformHandle;
+#define OPENGL_SHADER_INVALID_UNIFORM UINT32_MAX
+
+typedef enum {
+	OPENGL_SHADER_PENDING,
+	OPENGL_SHADER_READY,
+	OPENGL_SHADER_FAILED,
+} OpenGLShaderStatus;
+
+// Submits compile and link without waiting on the driver. With GL_KHR_parallel_shader_compile
+// the driver builds submitted programs concurrently, so submit every program up front and poll.
+// Compile and link errors are logged when the build completes.
+OpenGLShader *opengl_shader_submit(Arena *arena, const char *vertex_shader_source, const char *fragment_shader_source);
+// Non-blocking, finishes the shader once GL_COMPLETION_STATUS_KHR reports it done
+OpenGLShaderStatus opengl_shader_poll(OpenGLShader *shader);
+// Blocks until the build completes. Activating a pending shader or resolving its uniforms waits too.
+OpenGLShaderStatus opengl_shader_wait(OpenGLShader *shader);
+// submit + wait
 OpenGLShader *opengl_shader_create(Arena *arena, const char *vertex_shader_source, const char *fragment_shader_source);
+// Rebuilds the program from new sources and swaps it in only if it links. Uniform handles stay
+// valid and values set through the setters are restored on the new program.
+bool opengl_shader_reload(OpenGLShader *shader, Arena *arena, const char *vertex_shader_source, const char *fragment_shader_source);
+// Deletes the program, or the build still in flight. The shader itself stays in its arena.
+// Shaders the GPU may still use go through release_queue_shader instead.
+void opengl_shader_destroy(OpenGLShader *shader);
 
-void opengl_shader_activate(const OpenGLShader *shader);
+void opengl_shader_activate(OpenGLShader *shader);
 void opengl_shader_deactivate(const OpenGLShader *shader);
+uint32_t opengl_shader_id(const OpenGLShader *shader);
+
+UniformHandle opengl_shader_uniform_handle(OpenGLShader *shader, const char *name);
 
 void opengl_shader_seti(OpenGLShader *shader, const char *name, int32_t value);
 void opengl_shader_setf(OpenGLShader *shader, const char *name, float value);
@@ -16,3 +45,10 @@ void opengl_shader_set2fv(OpenGLShader *shader, const char *name, float *value);
 void opengl_shader_set3fv(OpenGLShader *shader, const char *name, float *value);
 void opengl_shader_set4fv(OpenGLShader *shader, const char *name, float *value);
 void opengl_shader_set4fm(OpenGLShader *shader, const char *name, float *value);
+
+void opengl_shader_seti_h(OpenGLShader *shader, UniformHandle handle, int32_t value);
+void opengl_shader_setf_h(OpenGLShader *shader, UniformHandle handle, float value);
+void opengl_shader_set2fv_h(OpenGLShader *shader, UniformHandle handle, float *value);
+void opengl_shader_set3fv_h(OpenGLShader *shader, UniformHandle handle, float *value);
+void opengl_shader_set4fv_h(OpenGLShader *shader, UniformHandle handle, float *value);
+void opengl_shader_set4fm_h(OpenGLShader *shader, UniformHandle handle, float *value);
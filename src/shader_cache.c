@@ -0,0 +1,183 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "shader_cache.h"
+
+#include "core/logger.h"
+
+#include <glad/gl.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define shader_cache_mkdir(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define shader_cache_mkdir(path) mkdir(path, 0755)
+#endif
+
+#define SHADER_CACHE_MAGIC 0x48435342u // "BSCH"
+#define SHADER_CACHE_VERSION 1
+#define SHADER_CACHE_DIRECTORY_LENGTH 256
+#define SHADER_CACHE_PATH_LENGTH 512
+
+typedef struct {
+	uint32_t magic, version;
+	uint64_t driver_hash, source_hash;
+	uint32_t format, length;
+} ShaderCacheHeader;
+
+typedef struct {
+	bool enabled;
+	char directory[SHADER_CACHE_DIRECTORY_LENGTH];
+	uint64_t driver_hash;
+
+	ShaderCacheStats stats;
+} ShaderCache;
+
+static ShaderCache g_shader_cache = { 0 };
+
+static uint64_t hash_string(uint64_t hash, const char *string) {
+	for (; *string; string++)
+		hash = (hash ^ (uint8_t)*string) * 1099511628211ull;
+	// Terminator keeps ("ab", "c") and ("a", "bc") apart
+	return hash * 1099511628211ull;
+}
+
+uint64_t shader_cache_key(const char *vertex_shader_source, const char *fragment_shader_source) {
+	uint64_t hash = 14695981039346656037ull;
+	hash = hash_string(hash, vertex_shader_source);
+	return hash_string(hash, fragment_shader_source);
+}
+
+static void entry_path(uint64_t key, char *path) {
+	snprintf(path, SHADER_CACHE_PATH_LENGTH, "%s/%016llx.bin", g_shader_cache.directory, (unsigned long long)key);
+}
+
+void shader_cache_startup(const char *directory) {
+	g_shader_cache = (ShaderCache){ 0 };
+
+	int32_t format_count = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+	if (format_count == 0) {
+		LOG_WARN("SHADER_CACHE: Driver exposes no program binary formats, cache disabled");
+		return;
+	}
+
+	if (shader_cache_mkdir(directory) != 0 && errno != EEXIST) {
+		LOG_WARN("SHADER_CACHE: Cannot create '%s': %s, cache disabled", directory, strerror(errno));
+		return;
+	}
+
+	uint64_t hash = 14695981039346656037ull;
+	hash = hash_string(hash, (const char *)glGetString(GL_VENDOR));
+	hash = hash_string(hash, (const char *)glGetString(GL_RENDERER));
+	hash = hash_string(hash, (const char *)glGetString(GL_VERSION));
+
+	g_shader_cache.enabled = true;
+	g_shader_cache.driver_hash = hash;
+	snprintf(g_shader_cache.directory, sizeof(g_shader_cache.directory), "%s", directory);
+}
+
+bool shader_cache_load(uint32_t program, uint64_t key) {
+	if (!g_shader_cache.enabled)
+		return false;
+
+	char path[SHADER_CACHE_PATH_LENGTH];
+	entry_path(key, path);
+
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		g_shader_cache.stats.miss_count++;
+		return false;
+	}
+
+	ShaderCacheHeader header = { 0 };
+	bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+		header.magic == SHADER_CACHE_MAGIC && header.version == SHADER_CACHE_VERSION &&
+		header.driver_hash == g_shader_cache.driver_hash && header.source_hash == key;
+
+	void *binary = valid ? malloc(header.length) : NULL;
+	valid = valid && binary && fread(binary, 1, header.length, file) == header.length;
+	fclose(file);
+
+	int32_t linked = GL_FALSE;
+	if (valid) {
+		glProgramBinary(program, header.format, binary, header.length);
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	}
+	free(binary);
+
+	if (linked != GL_TRUE) {
+		// Stale or foreign entry, the caller recompiles and overwrites it
+		LOG_DEBUG("SHADER_CACHE: Rejected '%s'", path);
+		g_shader_cache.stats.reject_count++;
+		g_shader_cache.stats.miss_count++;
+		return false;
+	}
+
+	g_shader_cache.stats.hit_count++;
+	return true;
+}
+
+void shader_cache_store(uint32_t program, uint64_t key) {
+	if (!g_shader_cache.enabled)
+		return;
+
+	int32_t linked = GL_FALSE, length = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (linked != GL_TRUE || length <= 0)
+		return;
+
+	ShaderCacheHeader header = {
+		.magic = SHADER_CACHE_MAGIC,
+		.version = SHADER_CACHE_VERSION,
+		.driver_hash = g_shader_cache.driver_hash,
+		.source_hash = key,
+	};
+
+	void *binary = malloc(length);
+	int32_t written = 0;
+	glGetProgramBinary(program, length, &written, &header.format, binary);
+	header.length = written;
+
+	char path[SHADER_CACHE_PATH_LENGTH];
+	entry_path(key, path);
+
+	FILE *file = fopen(path, "wb");
+	if (file == NULL) {
+		LOG_WARN("SHADER_CACHE: Cannot write '%s': %s", path, strerror(errno));
+		free(binary);
+		return;
+	}
+
+	bool complete = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(binary, 1, header.length, file) == header.length;
+	fclose(file);
+	free(binary);
+
+	// A truncated entry would only be rejected later, drop it now
+	if (!complete) {
+		remove(path);
+		return;
+	}
+	g_shader_cache.stats.store_count++;
+}
+
+ShaderCacheStats shader_cache_stats(void) {
+	return g_shader_cache.stats;
+}
+
+void shader_cache_log_stats(void) {
+	if (!g_shader_cache.enabled)
+		return;
+
+	ShaderCacheStats stats = g_shader_cache.stats;
+	LOG_INFO("SHADER_CACHE: %u hits, %u misses (%u rejected), %u stored in '%s'",
+		stats.hit_count, stats.miss_count, stats.reject_count, stats.store_count, g_shader_cache.directory);
+}
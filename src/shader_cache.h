@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+	uint32_t hit_count, miss_count;
+	// Cache files that existed but were written by another driver or failed to link
+	uint32_t reject_count;
+	uint32_t store_count;
+} ShaderCacheStats;
+
+// Linked program binaries are stored in directory, keyed by a hash of the shader sources.
+// Entries carry a hash of the GL vendor, renderer and version strings so a driver update
+// invalidates them. Requires a current GL context.
+void shader_cache_startup(const char *directory);
+
+// 64-bit FNV-1a of both sources, names the cache entry
+uint64_t shader_cache_key(const char *vertex_shader_source, const char *fragment_shader_source);
+
+// Loads the cached binary for key into program, returns false on a miss
+bool shader_cache_load(uint32_t program, uint64_t key);
+// Writes the binary of a successfully linked program, linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+void shader_cache_store(uint32_t program, uint64_t key);
+
+ShaderCacheStats shader_cache_stats(void);
+void shader_cache_log_stats(void);
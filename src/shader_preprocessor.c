@@ -0,0 +1,181 @@
+#include "shader_preprocessor.h"
+
+#include "asset_file.h"
+#include "core/logger.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+	char *data;
+	size_t length, capacity;
+	// Set once an allocation failed, later appends do nothing
+	bool failed;
+} StringBuilder;
+
+static void builder_append(StringBuilder *builder, const char *string, size_t length) {
+	if (builder->failed)
+		return;
+
+	if (builder->length + length + 1 > builder->capacity) {
+		size_t capacity = builder->capacity ? builder->capacity : 4096;
+		while (builder->length + length + 1 > capacity)
+			capacity *= 2;
+		char *data = realloc(builder->data, capacity);
+		if (data == NULL) {
+			builder->failed = true;
+			return;
+		}
+		builder->data = data;
+		builder->capacity = capacity;
+	}
+	memcpy(builder->data + builder->length, string, length);
+	builder->length += length;
+	builder->data[builder->length] = '\0';
+}
+
+static void builder_append_line_directive(StringBuilder *builder, uint32_t line_number, uint32_t source) {
+	char line[64];
+	int length = snprintf(line, sizeof(line), "#line %u %u\n", line_number, source);
+	builder_append(builder, line, (size_t)length);
+}
+
+// Matches "#<directive>" with optional whitespace around the '#', returns the text after it or NULL
+static const char *match_directive(const char *line, const char *end, const char *directive) {
+	while (line < end && (*line == ' ' || *line == '\t'))
+		line++;
+	if (line == end || *line != '#')
+		return NULL;
+	line++;
+	while (line < end && (*line == ' ' || *line == '\t'))
+		line++;
+
+	size_t length = strlen(directive);
+	if ((size_t)(end - line) < length || strncmp(line, directive, length) != 0)
+		return NULL;
+	line += length;
+	if (line < end && !isspace((unsigned char)*line))
+		return NULL;
+	return line;
+}
+
+static bool preprocess_file(PreprocessedShader *shader, StringBuilder *builder, uint32_t index) {
+	AssetFile file;
+	if (!asset_file_read(shader->files[index], &file))
+		return false;
+	const char *text = file.data;
+
+	// Directory of this file, include paths are relative to it
+	const char *path = shader->files[index];
+	const char *separator = strrchr(path, '/');
+	int directory_length = separator ? (int)(separator - path + 1) : 0;
+
+	bool success = true;
+	uint32_t line_number = 1;
+	for (const char *line = text; *line; line_number++) {
+		const char *end = strchr(line, '\n');
+		const char *next = end ? end + 1 : line + strlen(line);
+		if (end == NULL)
+			end = next;
+
+		const char *argument = match_directive(line, end, "include");
+		if (argument) {
+			const char *open = memchr(argument, '"', end - argument);
+			const char *close = open ? memchr(open + 1, '"', end - open - 1) : NULL;
+			if (close == NULL) {
+				LOG_ERROR("SHADER: %s:%u: Malformed #include", path, line_number);
+				success = false;
+				break;
+			}
+
+			char include[SHADER_PREPROCESSOR_PATH_LENGTH];
+			snprintf(include, sizeof(include), "%.*s%.*s", directory_length, path, (int)(close - open - 1), open + 1);
+
+			uint32_t existing = 0;
+			while (existing < shader->file_count && strcmp(shader->files[existing], include) != 0)
+				existing++;
+
+			if (existing == shader->file_count) {
+				if (shader->file_count == SHADER_PREPROCESSOR_MAX_FILES) {
+					LOG_ERROR("SHADER: %s:%u: More than %d files included", path, line_number, SHADER_PREPROCESSOR_MAX_FILES);
+					success = false;
+					break;
+				}
+
+				uint32_t include_index = shader->file_count++;
+				memcpy(shader->files[include_index], include, sizeof(include));
+
+				builder_append_line_directive(builder, 1, include_index);
+				if (!preprocess_file(shader, builder, include_index)) {
+					LOG_ERROR("SHADER: %s:%u: Failed to include '%s'", path, line_number, include);
+					success = false;
+					break;
+				}
+				builder_append_line_directive(builder, line_number + 1, index);
+			}
+		} else {
+			builder_append(builder, line, end - line);
+			builder_append(builder, "\n", 1);
+
+			if (index == 0 && shader->prologue_length == 0 && match_directive(line, end, "version")) {
+				shader->prologue_length = builder->length;
+				shader->prologue_lines = line_number;
+			}
+		}
+
+		line = next;
+	}
+
+	asset_file_release(&file);
+	return success;
+}
+
+bool shader_preprocess(const char *path, PreprocessedShader *shader) {
+	*shader = (PreprocessedShader){ .file_count = 1 };
+	snprintf(shader->files[0], sizeof(shader->files[0]), "%s", path);
+
+	// An empty file still gets an empty source
+	StringBuilder builder = { 0 };
+	builder_append(&builder, "", 0);
+	bool success = preprocess_file(shader, &builder, 0);
+	if (builder.failed)
+		LOG_ERROR("SHADER: %s: Out of memory", path);
+	if (!success || builder.failed) {
+		free(builder.data);
+		shader->source = NULL;
+		return false;
+	}
+
+	shader->source = builder.data;
+	return true;
+}
+
+void shader_preprocess_release(PreprocessedShader *shader) {
+	free(shader->source);
+	shader->source = NULL;
+}
+
+char *shader_preprocess_variant(const PreprocessedShader *shader, const char *const *features, uint32_t feature_count, uint32_t feature_mask) {
+	StringBuilder builder = { 0 };
+	builder_append(&builder, shader->source, shader->prologue_length);
+
+	for (uint32_t i = 0; i < feature_count; i++) {
+		if (feature_mask & (1u << i)) {
+			builder_append(&builder, "#define ", 8);
+			builder_append(&builder, features[i], strlen(features[i]));
+			builder_append(&builder, " 1\n", 3);
+		}
+	}
+	if (feature_mask)
+		builder_append_line_directive(&builder, shader->prologue_lines + 1, 0);
+
+	const char *body = shader->source + shader->prologue_length;
+	builder_append(&builder, body, strlen(body));
+	if (builder.failed) {
+		free(builder.data);
+		return NULL;
+	}
+	return builder.data;
+}
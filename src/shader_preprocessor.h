@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHADER_PREPROCESSOR_MAX_FILES 16
+#define SHADER_PREPROCESSOR_PATH_LENGTH 256
+
+typedef struct {
+	char *source;
+	// Bytes and lines up to and including the #version line, variant defines go right after it
+	size_t prologue_length;
+	uint32_t prologue_lines;
+
+	// Every file the source was assembled from, the root first. The index of a file is its
+	// GLSL source string number, so "2:14(3)" in a driver log is line 14 of files[2].
+	char files[SHADER_PREPROCESSOR_MAX_FILES][SHADER_PREPROCESSOR_PATH_LENGTH];
+	uint32_t file_count;
+} PreprocessedShader;
+
+// Resolves #include "path" relative to the including file. Each file is included at most once,
+// and #line directives keep driver log line numbers pointing into the original files.
+bool shader_preprocess(const char *path, PreprocessedShader *shader);
+void shader_preprocess_release(PreprocessedShader *shader);
+
+// Returns a malloc'd copy of the source with "#define <features[i]> 1" for every bit i set in feature_mask,
+// NULL when out of memory
+char *shader_preprocess_variant(const PreprocessedShader *shader, const char *const *features, uint32_t feature_count, uint32_t feature_mask);
@@ -0,0 +1,223 @@
+#include "software_renderer.h"
+
+#include "core/arena.h"
+#include "texture.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFTWARE_RENDERER_SSE2
+#endif
+
+#define SPAN_CHUNK 64
+
+struct _software_renderer {
+	uint32_t width, height;
+	uint8_t *pixels;
+	SoftwareFilter filter;
+};
+
+SoftwareRenderer *software_renderer_create(Arena *arena, uint32_t width, uint32_t height) {
+	SoftwareRenderer *renderer = arena_push_type(arena, SoftwareRenderer);
+	*renderer = (SoftwareRenderer){
+		.width = width,
+		.height = height,
+		.pixels = arena_push_zero(arena, (size_t)width * height * 4),
+		.filter = SOFTWARE_FILTER_NEAREST,
+	};
+	return renderer;
+}
+
+void software_renderer_set_filter(SoftwareRenderer *renderer, SoftwareFilter filter) {
+	renderer->filter = filter;
+}
+
+static uint8_t unorm8(float value) {
+	value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+	return (uint8_t)(value * 255.0f + 0.5f);
+}
+
+void software_renderer_clear(SoftwareRenderer *renderer, const float color[4]) {
+	uint8_t texel[4] = { unorm8(color[0]), unorm8(color[1]), unorm8(color[2]), unorm8(color[3]) };
+	uint32_t value;
+	memcpy(&value, texel, sizeof(value));
+
+	size_t count = (size_t)renderer->width * renderer->height, i = 0;
+	uint8_t *destination = renderer->pixels;
+#ifdef SOFTWARE_RENDERER_SSE2
+	__m128i fill = _mm_set1_epi32((int32_t)value);
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_si128((__m128i *)(destination + i * 4), fill);
+#endif
+	for (; i < count; i++)
+		memcpy(destination + i * 4, &value, sizeof(value));
+}
+
+// dst = src * tint, then blended over dst with src alpha (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA).
+// tint holds r, g, b, 256 in 8.8 fixed point.
+static void span_blend(uint8_t *destination, const uint8_t *source, uint32_t count, const uint16_t tint[4]) {
+	uint32_t i = 0;
+#ifdef SOFTWARE_RENDERER_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i tint16 = _mm_set_epi16(tint[3], tint[2], tint[1], tint[0], tint[3], tint[2], tint[1], tint[0]);
+	const __m128i max = _mm_set1_epi16(255);
+	const __m128i one = _mm_set1_epi16(1);
+
+	for (; i + 4 <= count; i += 4) {
+		__m128i src = _mm_loadu_si128((const __m128i *)(source + i * 4));
+		__m128i dst = _mm_loadu_si128((const __m128i *)(destination + i * 4));
+
+		__m128i halves[2];
+		for (int half = 0; half < 2; half++) {
+			__m128i s = half ? _mm_unpackhi_epi8(src, zero) : _mm_unpacklo_epi8(src, zero);
+			__m128i d = half ? _mm_unpackhi_epi8(dst, zero) : _mm_unpacklo_epi8(dst, zero);
+
+			s = _mm_srli_epi16(_mm_mullo_epi16(s, tint16), 8);
+			__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+			__m128i inverse = _mm_sub_epi16(max, alpha);
+
+			// (s * a + d * (255 - a)) / 255, with x / 255 ~= (x + 1 + (x >> 8)) >> 8
+			__m128i sum = _mm_add_epi16(_mm_mullo_epi16(s, alpha), _mm_mullo_epi16(d, inverse));
+			sum = _mm_add_epi16(sum, _mm_add_epi16(one, _mm_srli_epi16(sum, 8)));
+			halves[half] = _mm_srli_epi16(sum, 8);
+		}
+
+		_mm_storeu_si128((__m128i *)(destination + i * 4), _mm_packus_epi16(halves[0], halves[1]));
+	}
+#endif
+	for (; i < count; i++) {
+		const uint8_t *s = source + i * 4;
+		uint8_t *d = destination + i * 4;
+
+		uint32_t tinted[4];
+		for (int c = 0; c < 4; c++)
+			tinted[c] = ((uint32_t)s[c] * tint[c]) >> 8;
+
+		uint32_t alpha = tinted[3], inverse = 255 - alpha;
+		for (int c = 0; c < 4; c++) {
+			uint32_t sum = tinted[c] * alpha + d[c] * inverse;
+			d[c] = (uint8_t)((sum + 1 + (sum >> 8)) >> 8);
+		}
+	}
+}
+
+static void sample_nearest(const OpenGLTexture *texture, float u, float v, uint8_t *out) {
+	int32_t x = (int32_t)floorf(u), y = (int32_t)floorf(v);
+	x = x < 0 ? 0 : (x >= (int32_t)texture->width ? (int32_t)texture->width - 1 : x);
+	y = y < 0 ? 0 : (y >= (int32_t)texture->height ? (int32_t)texture->height - 1 : y);
+	memcpy(out, texture->pixels + ((size_t)y * texture->width + x) * 4, 4);
+}
+
+static void sample_bilinear(const OpenGLTexture *texture, float u, float v, uint8_t *out) {
+	u -= 0.5f;
+	v -= 0.5f;
+	float fx = floorf(u), fy = floorf(v);
+	uint32_t wx = (uint32_t)((u - fx) * 256.0f), wy = (uint32_t)((v - fy) * 256.0f);
+
+	int32_t x0 = (int32_t)fx, y0 = (int32_t)fy;
+	int32_t max_x = (int32_t)texture->width - 1, max_y = (int32_t)texture->height - 1;
+	int32_t x1 = x0 + 1, y1 = y0 + 1;
+	x0 = x0 < 0 ? 0 : (x0 > max_x ? max_x : x0);
+	x1 = x1 < 0 ? 0 : (x1 > max_x ? max_x : x1);
+	y0 = y0 < 0 ? 0 : (y0 > max_y ? max_y : y0);
+	y1 = y1 < 0 ? 0 : (y1 > max_y ? max_y : y1);
+
+	const uint8_t *t00 = texture->pixels + ((size_t)y0 * texture->width + x0) * 4;
+	const uint8_t *t10 = texture->pixels + ((size_t)y0 * texture->width + x1) * 4;
+	const uint8_t *t01 = texture->pixels + ((size_t)y1 * texture->width + x0) * 4;
+	const uint8_t *t11 = texture->pixels + ((size_t)y1 * texture->width + x1) * 4;
+
+	for (int c = 0; c < 4; c++) {
+		uint32_t top = t00[c] * (256 - wx) + t10[c] * wx;
+		uint32_t bottom = t01[c] * (256 - wx) + t11[c] * wx;
+		out[c] = (uint8_t)((top * (256 - wy) + bottom * wy) >> 16);
+	}
+}
+
+void software_renderer_draw_quad(SoftwareRenderer *renderer, const OpenGLTexture *texture, const float uv[4], const float position[2], const float size[2], float rotate, const float color[3]) {
+	if (texture == NULL || texture->pixels == NULL || size[0] == 0.0f || size[1] == 0.0f)
+		return;
+
+	float c = 1.0f, s = 0.0f;
+	if (rotate != 0.0f) {
+		float radians = rotate * 3.14159265358979f / 180.0f;
+		c = cosf(radians);
+		s = sinf(radians);
+	}
+
+	float half_width = size[0] * 0.5f, half_height = size[1] * 0.5f;
+	float center_x = position[0] + half_width, center_y = position[1] + half_height;
+
+	float corners[4][2];
+	const float local[4][2] = { { -half_width, -half_height }, { half_width, -half_height }, { half_width, half_height }, { -half_width, half_height } };
+	float min_y = INFINITY, max_y = -INFINITY;
+	for (int i = 0; i < 4; i++) {
+		corners[i][0] = center_x + local[i][0] * c - local[i][1] * s;
+		corners[i][1] = center_y + local[i][0] * s + local[i][1] * c;
+		min_y = fminf(min_y, corners[i][1]);
+		max_y = fmaxf(max_y, corners[i][1]);
+	}
+
+	// Texel coordinates are affine in screen space: t = origin + dx * (x - cx) + dy * (y - cy)
+	float texel_width = (uv[2] - uv[0]) * texture->width, texel_height = (uv[3] - uv[1]) * texture->height;
+	float u_origin = (uv[0] + uv[2]) * 0.5f * texture->width, v_origin = (uv[1] + uv[3]) * 0.5f * texture->height;
+	float du_dx = c / size[0] * texel_width, du_dy = s / size[0] * texel_width;
+	float dv_dx = -s / size[1] * texel_height, dv_dy = c / size[1] * texel_height;
+
+	uint16_t tint[4] = { unorm8(color[0]) + 1, unorm8(color[1]) + 1, unorm8(color[2]) + 1, 256 };
+	for (int i = 0; i < 3; i++)
+		tint[i] = tint[i] == 1 ? 0 : tint[i];
+
+	int32_t first_row = (int32_t)floorf(min_y), last_row = (int32_t)ceilf(max_y);
+	first_row = first_row < 0 ? 0 : first_row;
+	last_row = last_row > (int32_t)renderer->height ? (int32_t)renderer->height : last_row;
+
+	uint8_t texels[SPAN_CHUNK * 4];
+	for (int32_t y = first_row; y < last_row; y++) {
+		float sample_y = y + 0.5f;
+
+		// Span of the convex quad on this scanline
+		float left = INFINITY, right = -INFINITY;
+		for (int i = 0; i < 4; i++) {
+			const float *a = corners[i], *b = corners[(i + 1) % 4];
+			if ((a[1] <= sample_y && b[1] > sample_y) || (b[1] <= sample_y && a[1] > sample_y)) {
+				float x = a[0] + (sample_y - a[1]) * (b[0] - a[0]) / (b[1] - a[1]);
+				left = fminf(left, x);
+				right = fmaxf(right, x);
+			}
+		}
+		if (left >= right)
+			continue;
+
+		int32_t first_column = (int32_t)ceilf(left - 0.5f), end_column = (int32_t)ceilf(right - 0.5f);
+		first_column = first_column < 0 ? 0 : first_column;
+		end_column = end_column > (int32_t)renderer->width ? (int32_t)renderer->width : end_column;
+
+		float u = u_origin + du_dx * (first_column + 0.5f - center_x) + du_dy * (sample_y - center_y);
+		float v = v_origin + dv_dx * (first_column + 0.5f - center_x) + dv_dy * (sample_y - center_y);
+		uint8_t *row = renderer->pixels + (size_t)y * renderer->width * 4;
+
+		for (int32_t x = first_column; x < end_column; x += SPAN_CHUNK) {
+			uint32_t count = end_column - x < SPAN_CHUNK ? (uint32_t)(end_column - x) : SPAN_CHUNK;
+			for (uint32_t i = 0; i < count; i++, u += du_dx, v += dv_dx) {
+				if (renderer->filter == SOFTWARE_FILTER_BILINEAR)
+					sample_bilinear(texture, u, v, texels + i * 4);
+				else
+					sample_nearest(texture, u, v, texels + i * 4);
+			}
+			span_blend(row + (size_t)x * 4, texels, count, tint);
+		}
+	}
+}
+
+const uint8_t *software_renderer_pixels(const SoftwareRenderer *renderer) {
+	return renderer->pixels;
+}
+uint32_t software_renderer_width(const SoftwareRenderer *renderer) {
+	return renderer->width;
+}
+uint32_t software_renderer_height(const SoftwareRenderer *renderer) {
+	return renderer->height;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct _arena Arena;
+typedef struct _gl_texture OpenGLTexture;
+
+typedef struct _software_renderer SoftwareRenderer;
+
+typedef enum {
+	SOFTWARE_FILTER_NEAREST,
+	SOFTWARE_FILTER_BILINEAR,
+} SoftwareFilter;
+
+// CPU rasterizer drawing into an RGBA8 framebuffer with row 0 at the top of the screen.
+// Textures must be headless so their texels are in CPU memory.
+SoftwareRenderer *software_renderer_create(Arena *arena, uint32_t width, uint32_t height);
+void software_renderer_set_filter(SoftwareRenderer *renderer, SoftwareFilter filter);
+
+void software_renderer_clear(SoftwareRenderer *renderer, const float color[4]);
+// Same placement as the GL sprite path: rotate degrees around the center of the position/size rectangle
+void software_renderer_draw_quad(SoftwareRenderer *renderer, const OpenGLTexture *texture, const float uv[4], const float position[2], const float size[2], float rotate, const float color[3]);
+
+const uint8_t *software_renderer_pixels(const SoftwareRenderer *renderer);
+uint32_t software_renderer_width(const SoftwareRenderer *renderer);
+uint32_t software_renderer_height(const SoftwareRenderer *renderer);
@@ -2,36 +2,303 @@
 
 #include "core/arena.h"
 #include "core/logger.h"
+#include "gl_state.h"
 
 #include <glad/gl.h>
 #include <stb/stb_image.h>
 
+#include <stdlib.h>
+#include <string.h>
 
-OpenGLTexture *opengl_texture_load(Arena *arena, uint32_t width, uint32_t height, uint32_t channels, const uint8_t *pixels) {
-	OpenGLTexture *texture = arena_push_type(arena, OpenGLTexture);
+static bool g_texture_headless = false;
+static bool g_texture_array_mode = false;
 
-	glCreateTextures(GL_TEXTURE_2D, 1, &texture->id);
+void opengl_texture_set_headless(bool headless) {
+	g_texture_headless = headless;
+}
+
+bool opengl_texture_headless(void) {
+	return g_texture_headless;
+}
+
+void opengl_texture_set_array_mode(bool enabled) {
+	g_texture_array_mode = enabled;
+}
+
+bool opengl_texture_array_mode(void) {
+	return g_texture_array_mode && !g_texture_headless;
+}
+
+// In array mode every texture is an array, a single texture gets one layer
+static void texture_create(OpenGLTexture *texture, uint32_t layer_count) {
+	texture->layer_count = layer_count;
+	glCreateTextures(layer_count ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, 1, &texture->id);
 
 	glTextureParameteri(texture->id, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTextureParameteri(texture->id, GL_TEXTURE_WRAP_T, GL_REPEAT);
+}
+
+static void texture_storage(const OpenGLTexture *texture, GLenum internal_format) {
+	if (texture->layer_count)
+		glTextureStorage3D(texture->id, texture->level_count, internal_format, texture->width, texture->height, texture->layer_count);
+	else
+		glTextureStorage2D(texture->id, texture->level_count, internal_format, texture->width, texture->height);
+}
+
+static void texture_sub_image(const OpenGLTexture *texture, uint32_t level, uint32_t layer, uint32_t x, uint32_t y, uint32_t width, uint32_t height, GLenum format, const void *pixels) {
+	if (texture->layer_count)
+		glTextureSubImage3D(texture->id, level, x, y, layer, width, height, 1, format, GL_UNSIGNED_BYTE, pixels);
+	else
+		glTextureSubImage2D(texture->id, level, x, y, width, height, format, GL_UNSIGNED_BYTE, pixels);
+}
+
+// Without an arena the texture is on the heap and opengl_texture_destroy frees it
+static OpenGLTexture *texture_alloc(Arena *arena) {
+	OpenGLTexture *texture = arena ? arena_push(arena, sizeof(OpenGLTexture)) : malloc(sizeof(OpenGLTexture));
+	if (texture == NULL) {
+		LOG_ERROR("Failed to allocate texture");
+		exit(1);
+	}
+	*texture = (OpenGLTexture){ .path = NULL, .heap_allocated = arena == NULL };
+	return texture;
+}
+
+OpenGLTexture *opengl_texture_load(Arena *arena, uint32_t width, uint32_t height, uint32_t channels, const uint8_t *pixels, MipmapFilter filter) {
+	if (filter != MIPMAP_FILTER_NONE && pixels) {
+		MipChain chain;
+		if (mipmap_generate(pixels, width, height, channels, true, filter, &chain)) {
+			OpenGLTexture *texture = opengl_texture_load_mips(arena, &chain);
+			mipmap_release(&chain);
+			return texture;
+		}
+		LOG_WARN("Failed to generate mipmaps for %ux%u texture, using level 0 only", width, height);
+	}
+
+	OpenGLTexture *texture = texture_alloc(arena);
+	texture->width = width;
+	texture->height = height;
+	texture->channels = channels;
+	texture->level_count = 1;
+	texture->size = (size_t)width * height * 4;
+
+	if (g_texture_headless) {
+		texture->pixels = calloc((size_t)width * height, 4);
+		if (pixels)
+			opengl_texture_update(texture, 0, 0, 0, width, height, channels, pixels);
+		return texture;
+	}
+
+	texture_create(texture, g_texture_array_mode ? 1 : 0);
 	glTextureParameteri(texture->id, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTextureParameteri(texture->id, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-	glTextureStorage2D(texture->id, 1, GL_RGBA8, width, height);
-	glTextureSubImage2D(texture->id, 0, 0, 0, width, height, channels == 3 ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	texture_storage(texture, GL_RGBA8);
+	if (pixels)
+		opengl_texture_update(texture, 0, 0, 0, width, height, channels, pixels);
+	else
+		glClearTexImage(texture->id, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	return texture;
+}
 
+OpenGLTexture *opengl_texture_load_array(Arena *arena, uint32_t width, uint32_t height, uint32_t layer_count) {
+	OpenGLTexture *texture = texture_alloc(arena);
 	texture->width = width;
 	texture->height = height;
-	texture->channels = channels;
-	texture->path = NULL;
+	texture->channels = 4;
+	texture->level_count = 1;
+	texture->size = (size_t)width * height * 4 * layer_count;
+
+	texture_create(texture, layer_count);
+	glTextureParameteri(texture->id, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(texture->id, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	texture_storage(texture, GL_RGBA8);
+	glClearTexImage(texture->id, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	return texture;
+}
+
+void opengl_texture_resize_array(OpenGLTexture *texture, uint32_t layer_count) {
+	OpenGLTexture resized = *texture;
+	texture_create(&resized, layer_count);
+	glTextureParameteri(resized.id, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(resized.id, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	texture_storage(&resized, GL_RGBA8);
+	glClearTexImage(resized.id, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	uint32_t copied = texture->layer_count < layer_count ? texture->layer_count : layer_count;
+	glCopyImageSubData(texture->id, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, resized.id, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, texture->width, texture->height, copied);
+
+	opengl_state_forget_texture(texture->id);
+	glDeleteTextures(1, &texture->id);
+	texture->id = resized.id;
+	texture->layer_count = layer_count;
+	texture->size = (size_t)texture->width * texture->height * 4 * layer_count;
+}
+
+OpenGLTexture *opengl_texture_load_mips(Arena *arena, const MipChain *chain) {
+	OpenGLTexture *texture = texture_alloc(arena);
+	opengl_texture_upload_mips(texture, chain);
+	return texture;
+}
+
+void opengl_texture_upload_mips(OpenGLTexture *texture, const MipChain *chain) {
+	texture->width = chain->width;
+	texture->height = chain->height;
+	texture->channels = 4;
+	texture->level_count = chain->level_count;
+	texture->size = chain->size;
+
+	if (g_texture_headless) {
+		texture->level_count = 1;
+		texture->size = (size_t)chain->width * chain->height * 4;
+		texture->pixels = malloc(texture->size);
+		if (texture->pixels)
+			memcpy(texture->pixels, chain->pixels, texture->size);
+		return;
+	}
+
+	texture_create(texture, g_texture_array_mode ? 1 : 0);
+	glTextureParameteri(texture->id, GL_TEXTURE_MIN_FILTER, chain->level_count > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST);
+	glTextureParameteri(texture->id, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTextureParameteri(texture->id, GL_TEXTURE_MAX_LEVEL, chain->level_count - 1);
+
+	texture_storage(texture, GL_RGBA8);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (uint32_t level = 0; level < chain->level_count; level++) {
+		uint32_t width = mipmap_level_dimension(chain->width, level), height = mipmap_level_dimension(chain->height, level);
+		texture_sub_image(texture, level, 0, 0, 0, width, height, GL_RGBA, chain->pixels + chain->offsets[level]);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+// sRGB tagged images get the linear format as well. Nothing renders to an sRGB framebuffer and
+// every other texture is sampled as gamma space RGBA8, so decoding on sampling would draw the
+// cooked texture darker than its source image.
+static GLenum texture_ktx2_internal_format(Ktx2Format format) {
+	switch (format) {
+		case KTX2_FORMAT_RGBA8: return GL_RGBA8;
+		case KTX2_FORMAT_BC1: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+		case KTX2_FORMAT_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		case KTX2_FORMAT_BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+		default: return 0;
+	}
+}
+
+bool opengl_texture_ktx2_supported(Ktx2Format format) {
+	if (g_texture_headless)
+		return false;
+
+	switch (format) {
+		case KTX2_FORMAT_RGBA8: return true;
+		case KTX2_FORMAT_BC1:
+		case KTX2_FORMAT_BC3: return GLAD_GL_EXT_texture_compression_s3tc;
+		// BPTC is core since GL 4.2
+		case KTX2_FORMAT_BC7: return true;
+		default: return false;
+	}
+}
+
+OpenGLTexture *opengl_texture_load_ktx2(Arena *arena, const Ktx2Image *image) {
+	if (!opengl_texture_ktx2_supported(image->format))
+		return NULL;
+
+	OpenGLTexture *texture = texture_alloc(arena);
+	opengl_texture_upload_ktx2(texture, image);
 	return texture;
 }
+
+void opengl_texture_upload_ktx2(OpenGLTexture *texture, const Ktx2Image *image) {
+	GLenum internal_format = texture_ktx2_internal_format(image->format);
+	texture->width = image->width;
+	texture->height = image->height;
+	texture->channels = 4;
+	texture->level_count = image->level_count;
+	texture->size = 0;
+
+	texture_create(texture, g_texture_array_mode ? 1 : 0);
+	glTextureParameteri(texture->id, GL_TEXTURE_MIN_FILTER, image->level_count > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST);
+	glTextureParameteri(texture->id, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTextureParameteri(texture->id, GL_TEXTURE_MAX_LEVEL, image->level_count - 1);
+
+	texture_storage(texture, internal_format);
+	for (uint32_t level = 0; level < image->level_count; level++) {
+		uint32_t width = mipmap_level_dimension(image->width, level), height = mipmap_level_dimension(image->height, level);
+		GLsizei size = (GLsizei)image->levels[level].size;
+		if (image->format == KTX2_FORMAT_RGBA8)
+			texture_sub_image(texture, level, 0, 0, 0, width, height, GL_RGBA, image->levels[level].data);
+		else if (texture->layer_count)
+			glCompressedTextureSubImage3D(texture->id, level, 0, 0, 0, width, height, 1, internal_format, size, image->levels[level].data);
+		else
+			glCompressedTextureSubImage2D(texture->id, level, 0, 0, width, height, internal_format, size, image->levels[level].data);
+		texture->size += image->levels[level].size;
+	}
+}
+
+void opengl_texture_update(OpenGLTexture *texture, uint32_t layer, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t channels, const uint8_t *pixels) {
+	if (texture->pixels) {
+		for (uint32_t row = 0; row < height; row++) {
+			const uint8_t *source = pixels + (size_t)row * width * channels;
+			uint8_t *destination = texture->pixels + ((size_t)(y + row) * texture->width + x) * 4;
+			if (channels == 4) {
+				memcpy(destination, source, (size_t)width * 4);
+				continue;
+			}
+			for (uint32_t column = 0; column < width; column++, source += channels, destination += 4) {
+				destination[0] = source[0];
+				destination[1] = source[channels >= 3 ? 1 : 0];
+				destination[2] = source[channels >= 3 ? 2 : 0];
+				destination[3] = channels == 2 ? source[1] : 255;
+			}
+		}
+		return;
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	texture_sub_image(texture, 0, layer, x, y, width, height, channels == 3 ? GL_RGB : GL_RGBA, pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void opengl_texture_update_buffer(OpenGLTexture *texture, uint32_t layer, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t buffer, size_t offset) {
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	texture_sub_image(texture, 0, layer, x, y, width, height, GL_RGBA, (const void *)offset);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+TextureRegion opengl_texture_region(OpenGLTexture *texture, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+	return (TextureRegion){
+		.texture = texture,
+		.x = x,
+		.y = y,
+		.width = width,
+		.height = height,
+		.uv = {
+			(float)x / texture->width,
+			(float)y / texture->height,
+			(float)(x + width) / texture->width,
+			(float)(y + height) / texture->height,
+		},
+	};
+}
+
+void opengl_texture_evict(OpenGLTexture *texture) {
+	if (texture->pixels) {
+		free(texture->pixels);
+		texture->pixels = NULL;
+	} else if (texture->id) {
+		opengl_state_forget_texture(texture->id);
+		glDeleteTextures(1, &texture->id);
+		texture->id = 0;
+	}
+}
+
 void opengl_texture_destroy(OpenGLTexture *texture) {
-	if (texture) {
-		OpenGLTexture *gl_texture = (OpenGLTexture *)texture;
-		glDeleteTextures(1, &gl_texture->id);
+	if (texture == NULL)
+		return;
+
+	opengl_texture_evict(texture);
+	if (texture->heap_allocated)
 		free(texture);
-	}
 }
 
 void opengl_texture_activate(OpenGLTexture *texture, uint32_t texture_unit) {
@@ -40,5 +307,5 @@ void opengl_texture_activate(OpenGLTexture *texture, uint32_t texture_unit) {
 		exit(1);
 	}
 	OpenGLTexture *gl_texture = (OpenGLTexture *)texture;
-	glBindTextureUnit(texture_unit, gl_texture->id);
+	opengl_state_bind_texture_unit(texture_unit, gl_texture->id);
 }
@@ -1,5 +1,10 @@
 #pragma once
 
+#include "ktx2.h"
+#include "mipmap.h"
+
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 typedef struct _arena Arena;
@@ -7,11 +12,69 @@ typedef struct _arena Arena;
 typedef struct _gl_texture OpenGLTexture;
 struct _gl_texture {
 	uint32_t id;
-	uint32_t width, height, channels;
+	uint32_t width, height, channels, level_count;
+	// Layers of a GL_TEXTURE_2D_ARRAY, 0 for a plain GL_TEXTURE_2D
+	uint32_t layer_count;
+	// Estimated bytes of storage across all levels
+	size_t size;
+	// Index + 1 of its texture_residency entry, 0 when untracked
+	uint32_t residency;
 	const char *path;
+	// RGBA8 copy of the texels, only kept for headless textures
+	uint8_t *pixels;
+	// Loaded without an arena, opengl_texture_destroy frees it
+	bool heap_allocated;
+};
+
+// A sub-rectangle of a texture, uv holds the normalized u0, v0, u1, v1 bounds
+typedef struct _texture_region TextureRegion;
+struct _texture_region {
+	OpenGLTexture *texture;
+	uint32_t x, y, width, height;
+	// Array layer the region lives in, always 0 outside array mode
+	uint32_t layer;
+	float uv[4];
 };
 
-OpenGLTexture *opengl_texture_load(Arena *arena, uint32_t width, uint32_t height, uint32_t channels, const uint8_t *pixels);
+// Headless textures skip GL entirely and keep their texels in CPU memory for the software renderer
+void opengl_texture_set_headless(bool headless);
+bool opengl_texture_headless(void);
+// Array mode creates every texture as a GL_TEXTURE_2D_ARRAY so one sampler2DArray shader draws
+// them all and atlas pages become layers of a single texture. Set before creating any texture,
+// it has no effect on headless textures.
+void opengl_texture_set_array_mode(bool enabled);
+bool opengl_texture_array_mode(void);
+
+// The load functions allocate the texture from arena, or on the heap when it is NULL so a texture
+// released before its arena can be freed.
+// Any filter but MIPMAP_FILTER_NONE builds a full mip chain from pixels, treating color as sRGB
+OpenGLTexture *opengl_texture_load(Arena *arena, uint32_t width, uint32_t height, uint32_t channels, const uint8_t *pixels, MipmapFilter filter);
+// Uploads a chain built by mipmap_generate, minified with trilinear filtering. Headless textures
+// keep level 0 only.
+OpenGLTexture *opengl_texture_load_mips(Arena *arena, const MipChain *chain);
+// Uploads a cooked image with its mip chain, block compressed formats keep their compression.
+// Returns NULL for headless textures or formats the driver lacks, the caller falls back to the
+// source image then. opengl_texture_ktx2_supported is safe to call from any thread.
+bool opengl_texture_ktx2_supported(Ktx2Format format);
+OpenGLTexture *opengl_texture_load_ktx2(Arena *arena, const Ktx2Image *image);
+// Empty RGBA8 array with layer_count layers, GL textures only
+OpenGLTexture *opengl_texture_load_array(Arena *arena, uint32_t width, uint32_t height, uint32_t layer_count);
+// Moves an array to new storage with layer_count layers keeping the existing layers, the
+// OpenGLTexture stays valid but its id changes
+void opengl_texture_resize_array(OpenGLTexture *texture, uint32_t layer_count);
+// Create the storage of an existing texture, which is how an evicted texture comes back without
+// invalidating the regions pointing at it
+void opengl_texture_upload_mips(OpenGLTexture *texture, const MipChain *chain);
+void opengl_texture_upload_ktx2(OpenGLTexture *texture, const Ktx2Image *image);
+void opengl_texture_update(OpenGLTexture *texture, uint32_t layer, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t channels, const uint8_t *pixels);
+// Copies tightly packed RGBA8 texels from offset in a GL_PIXEL_UNPACK_BUFFER, GL textures only
+void opengl_texture_update_buffer(OpenGLTexture *texture, uint32_t layer, uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint32_t buffer, size_t offset);
+// Frees the storage but keeps the texture itself, it binds nothing until uploaded again
+void opengl_texture_evict(OpenGLTexture *texture);
+// Frees the storage, and the texture itself when it is on the heap. Textures the GPU may still
+// read go through release_queue_texture instead.
 void opengl_texture_destroy(OpenGLTexture *texture);
 
+TextureRegion opengl_texture_region(OpenGLTexture *texture, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
 void opengl_texture_activate(OpenGLTexture *texture, uint32_t texture_unit);
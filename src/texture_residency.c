@@ -0,0 +1,278 @@
+#include "texture_residency.h"
+
+#include "asset_file.h"
+#include "core/clock.h"
+#include "core/logger.h"
+#include "texture.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TEXTURE_RESIDENCY_MAX_TEXTURES 1024
+#define TEXTURE_RESIDENCY_NONE UINT32_MAX
+
+typedef struct {
+	// NULL while the entry is free
+	OpenGLTexture *texture;
+	// Reload source, cooked when it has levels and path otherwise
+	char *path;
+	MipmapFilter filter;
+	Ktx2Image cooked;
+
+	bool evictable, resident, failed;
+	uint64_t last_used_frame;
+	// Resident evictable entries, most recently used first. next links free entries as well.
+	uint32_t previous, next;
+} TextureResidency;
+
+typedef struct {
+	bool started;
+	TextureResidency entries[TEXTURE_RESIDENCY_MAX_TEXTURES];
+	uint32_t count;
+	uint32_t head, tail;
+	uint32_t first_free;
+	uint64_t frame;
+
+	TextureResidencyStats stats;
+} TextureResidencyManager;
+
+static TextureResidencyManager g_texture_residency = { 0 };
+
+void texture_residency_startup(size_t budget) {
+	g_texture_residency = (TextureResidencyManager){
+		.started = true,
+		.head = TEXTURE_RESIDENCY_NONE,
+		.tail = TEXTURE_RESIDENCY_NONE,
+		.first_free = TEXTURE_RESIDENCY_NONE,
+		.stats.budget = budget,
+	};
+}
+
+void texture_residency_shutdown(void) {
+	for (uint32_t i = 0; i < g_texture_residency.count; i++) {
+		free(g_texture_residency.entries[i].path);
+		ktx2_release(&g_texture_residency.entries[i].cooked);
+	}
+	g_texture_residency = (TextureResidencyManager){ 0 };
+}
+
+void texture_residency_set_budget(size_t budget) {
+	g_texture_residency.stats.budget = budget;
+}
+
+static void residency_unlink(uint32_t index) {
+	TextureResidency *entry = &g_texture_residency.entries[index];
+	if (entry->previous != TEXTURE_RESIDENCY_NONE)
+		g_texture_residency.entries[entry->previous].next = entry->next;
+	else
+		g_texture_residency.head = entry->next;
+	if (entry->next != TEXTURE_RESIDENCY_NONE)
+		g_texture_residency.entries[entry->next].previous = entry->previous;
+	else
+		g_texture_residency.tail = entry->previous;
+	entry->previous = entry->next = TEXTURE_RESIDENCY_NONE;
+}
+
+static void residency_push_front(uint32_t index) {
+	TextureResidency *entry = &g_texture_residency.entries[index];
+	entry->previous = TEXTURE_RESIDENCY_NONE;
+	entry->next = g_texture_residency.head;
+	if (g_texture_residency.head != TEXTURE_RESIDENCY_NONE)
+		g_texture_residency.entries[g_texture_residency.head].previous = index;
+	else
+		g_texture_residency.tail = index;
+	g_texture_residency.head = index;
+}
+
+static void residency_add_size(size_t size) {
+	g_texture_residency.stats.resident_size += size;
+	g_texture_residency.stats.resident_count++;
+	if (g_texture_residency.stats.resident_size > g_texture_residency.stats.peak_resident_size)
+		g_texture_residency.stats.peak_resident_size = g_texture_residency.stats.resident_size;
+}
+
+static TextureResidency *residency_add(OpenGLTexture *texture, bool evictable) {
+	if (!g_texture_residency.started)
+		return NULL;
+
+	uint32_t index = g_texture_residency.first_free;
+	if (index != TEXTURE_RESIDENCY_NONE) {
+		g_texture_residency.first_free = g_texture_residency.entries[index].next;
+	} else if (g_texture_residency.count < TEXTURE_RESIDENCY_MAX_TEXTURES) {
+		index = g_texture_residency.count++;
+	} else {
+		LOG_WARN("TEXTURES: Residency table full, %ux%u texture stays resident untracked", texture->width, texture->height);
+		return NULL;
+	}
+
+	TextureResidency *entry = &g_texture_residency.entries[index];
+	*entry = (TextureResidency){
+		.texture = texture,
+		.evictable = evictable,
+		.resident = true,
+		.last_used_frame = g_texture_residency.frame,
+		.previous = TEXTURE_RESIDENCY_NONE,
+		.next = TEXTURE_RESIDENCY_NONE,
+	};
+	texture->residency = index + 1;
+
+	g_texture_residency.stats.texture_count++;
+	residency_add_size(texture->size);
+	if (evictable)
+		residency_push_front(index);
+	return entry;
+}
+
+void texture_residency_pin(OpenGLTexture *texture) {
+	residency_add(texture, false);
+}
+
+void texture_residency_track(OpenGLTexture *texture, const char *path, MipmapFilter filter) {
+	size_t length = strlen(path) + 1;
+	char *copy = malloc(length);
+	if (copy == NULL) {
+		residency_add(texture, false);
+		return;
+	}
+	memcpy(copy, path, length);
+
+	TextureResidency *entry = residency_add(texture, true);
+	if (entry == NULL) {
+		free(copy);
+		return;
+	}
+	entry->path = copy;
+	entry->filter = filter;
+}
+
+void texture_residency_track_cooked(OpenGLTexture *texture, Ktx2Image *image) {
+	TextureResidency *entry = residency_add(texture, true);
+	if (entry == NULL) {
+		ktx2_release(image);
+		return;
+	}
+	entry->cooked = *image;
+	*image = (Ktx2Image){ 0 };
+}
+
+void texture_residency_untrack(OpenGLTexture *texture) {
+	if (texture == NULL || texture->residency == 0)
+		return;
+
+	uint32_t index = texture->residency - 1;
+	TextureResidency *entry = &g_texture_residency.entries[index];
+	if (entry->resident) {
+		if (entry->evictable)
+			residency_unlink(index);
+		g_texture_residency.stats.resident_size -= texture->size;
+		g_texture_residency.stats.resident_count--;
+	}
+	g_texture_residency.stats.texture_count--;
+
+	free(entry->path);
+	ktx2_release(&entry->cooked);
+	*entry = (TextureResidency){ .next = g_texture_residency.first_free };
+	g_texture_residency.first_free = index;
+	texture->residency = 0;
+}
+
+void texture_residency_resized(OpenGLTexture *texture, size_t previous_size) {
+	if (texture->residency == 0 || !g_texture_residency.entries[texture->residency - 1].resident)
+		return;
+	g_texture_residency.stats.resident_size += texture->size - previous_size;
+	if (g_texture_residency.stats.resident_size > g_texture_residency.stats.peak_resident_size)
+		g_texture_residency.stats.peak_resident_size = g_texture_residency.stats.resident_size;
+}
+
+static bool residency_reload(TextureResidency *entry) {
+	if (entry->cooked.level_count > 0) {
+		opengl_texture_upload_ktx2(entry->texture, &entry->cooked);
+		return true;
+	}
+
+	AssetImage image;
+	if (!asset_file_load_image(entry->path, &image))
+		return false;
+
+	MipChain chain;
+	bool success = mipmap_generate(image.pixels, image.width, image.height, image.channels, true, entry->filter, &chain);
+	asset_file_release_image(&image);
+	if (success) {
+		opengl_texture_upload_mips(entry->texture, &chain);
+		mipmap_release(&chain);
+	}
+	return success;
+}
+
+void texture_residency_touch(OpenGLTexture *texture) {
+	if (texture == NULL || texture->residency == 0)
+		return;
+
+	uint32_t index = texture->residency - 1;
+	TextureResidency *entry = &g_texture_residency.entries[index];
+	if (entry->last_used_frame == g_texture_residency.frame)
+		return;
+	entry->last_used_frame = g_texture_residency.frame;
+	if (!entry->evictable)
+		return;
+
+	if (!entry->resident) {
+		if (entry->failed)
+			return;
+
+		uint64_t start = clock_now_ns();
+		if (!residency_reload(entry)) {
+			LOG_ERROR("TEXTURES: Failed to reload evicted texture [ %s ]", entry->path ? entry->path : "cooked");
+			entry->failed = true;
+			return;
+		}
+		g_texture_residency.stats.reload_ms += (clock_now_ns() - start) / 1e6;
+		g_texture_residency.stats.reload_count++;
+		g_texture_residency.stats.reloaded_size += texture->size;
+
+		entry->resident = true;
+		residency_add_size(texture->size);
+		residency_push_front(index);
+		return;
+	}
+
+	residency_unlink(index);
+	residency_push_front(index);
+}
+
+void texture_residency_update(void) {
+	if (!g_texture_residency.started)
+		return;
+	g_texture_residency.frame++;
+
+	// Everything ahead of the first texture drawn last frame is older, so the walk stops there
+	while (g_texture_residency.stats.resident_size > g_texture_residency.stats.budget && g_texture_residency.tail != TEXTURE_RESIDENCY_NONE) {
+		uint32_t index = g_texture_residency.tail;
+		TextureResidency *entry = &g_texture_residency.entries[index];
+		if (entry->last_used_frame + 1 >= g_texture_residency.frame)
+			break;
+
+		residency_unlink(index);
+		opengl_texture_evict(entry->texture);
+		entry->resident = false;
+
+		g_texture_residency.stats.resident_size -= entry->texture->size;
+		g_texture_residency.stats.resident_count--;
+		g_texture_residency.stats.eviction_count++;
+		g_texture_residency.stats.evicted_size += entry->texture->size;
+	}
+}
+
+TextureResidencyStats texture_residency_stats(void) {
+	return g_texture_residency.stats;
+}
+
+void texture_residency_log_stats(void) {
+	if (!g_texture_residency.started)
+		return;
+
+	TextureResidencyStats stats = g_texture_residency.stats;
+	LOG_INFO("TEXTURES: %u/%u resident, %.1f MB of %.1f MB budget (peak %.1f MB), %u evictions (%.1f MB), %u reloads (%.1f MB, %.2f ms)",
+		stats.resident_count, stats.texture_count, stats.resident_size / 1048576.0, stats.budget / 1048576.0, stats.peak_resident_size / 1048576.0,
+		stats.eviction_count, stats.evicted_size / 1048576.0, stats.reload_count, stats.reloaded_size / 1048576.0, stats.reload_ms);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "ktx2.h"
+#include "mipmap.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct _gl_texture OpenGLTexture;
+
+#define TEXTURE_RESIDENCY_DEFAULT_BUDGET ((size_t)256 * 1024 * 1024)
+
+typedef struct {
+	size_t budget;
+	// Estimated bytes of every tracked texture that currently has storage
+	size_t resident_size, peak_resident_size;
+	uint32_t texture_count, resident_count;
+	uint32_t eviction_count, reload_count;
+	size_t evicted_size, reloaded_size;
+	// Time spent reloading, which happens on the draw path
+	double reload_ms;
+} TextureResidencyStats;
+
+// Keeps the estimated memory of tracked textures within a budget. Once a frame the least recently
+// used textures not drawn in the previous frame are evicted until the total fits again, an evicted
+// texture is reloaded the next time it is touched. Textures used in every frame are never evicted,
+// so the budget can be exceeded when a frame needs more than it allows.
+void texture_residency_startup(size_t budget);
+void texture_residency_shutdown(void);
+void texture_residency_set_budget(size_t budget);
+
+// Counts texture towards the budget without ever evicting it, for atlas pages that are filled
+// in place and have no single source to reload from
+void texture_residency_pin(OpenGLTexture *texture);
+// Evictable texture reloaded by decoding path again with filter
+void texture_residency_track(OpenGLTexture *texture, const char *path, MipmapFilter filter);
+// Evictable texture reloaded from a cooked image kept in CPU memory, takes ownership of image
+void texture_residency_track_cooked(OpenGLTexture *texture, Ktx2Image *image);
+
+// Stops tracking a texture about to be destroyed, its entry is reused by the next texture
+void texture_residency_untrack(OpenGLTexture *texture);
+
+// Adjusts the budget after a tracked texture changed size in place
+void texture_residency_resized(OpenGLTexture *texture, size_t previous_size);
+
+// Marks texture as used this frame and reloads it when it was evicted. Call before its id or
+// texels are read. Textures that are not tracked are ignored.
+void texture_residency_touch(OpenGLTexture *texture);
+// Starts a new frame and evicts down to the budget
+void texture_residency_update(void);
+
+TextureResidencyStats texture_residency_stats(void);
+void texture_residency_log_stats(void);
@@ -0,0 +1,159 @@
+#include "transform.h"
+
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFORM_SSE2
+#endif
+
+#define DEGREES_TO_RADIANS 0.017453292519943295f
+
+// Rows of the affine for one sprite, shared by the scalar tails
+static void transform_scalar(float x, float y, float width, float height, float rotation, float *a, float *b, float *c, float *d, float *tx, float *ty) {
+	if (rotation == 0.0f) {
+		*a = width, *b = 0.0f, *c = 0.0f, *d = height;
+		*tx = x, *ty = y;
+		return;
+	}
+
+	float cosine = cosf(rotation * DEGREES_TO_RADIANS), sine = sinf(rotation * DEGREES_TO_RADIANS);
+	*a = cosine * width, *b = sine * width;
+	*c = -sine * height, *d = cosine * height;
+
+	// Rotation is around the center, so the translation moves the rotated center back in place
+	*tx = x + 0.5f * width - 0.5f * (*a + *c);
+	*ty = y + 0.5f * height - 0.5f * (*b + *d);
+}
+
+#ifdef TRANSFORM_SSE2
+// sin and cos of four angles in radians: Cody-Waite reduction to [-pi/4, pi/4] and minimax
+// polynomials (cephes sinf/cosf coefficients), accurate to a few ulp for |x| < 8192
+static void sincos_ps(__m128 x, __m128 *sine, __m128 *cosine) {
+	const __m128 two_over_pi = _mm_set1_ps(0.636619772367581343f);
+	const __m128 pi_over_2_hi = _mm_set1_ps(1.5703125f);
+	const __m128 pi_over_2_mid = _mm_set1_ps(4.837512969970703125e-4f);
+	const __m128 pi_over_2_lo = _mm_set1_ps(7.54978995489188216e-8f);
+
+	__m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, two_over_pi));
+	__m128 j = _mm_cvtepi32_ps(quadrant);
+	__m128 r = _mm_sub_ps(x, _mm_mul_ps(j, pi_over_2_hi));
+	r = _mm_sub_ps(r, _mm_mul_ps(j, pi_over_2_mid));
+	r = _mm_sub_ps(r, _mm_mul_ps(j, pi_over_2_lo));
+	__m128 r2 = _mm_mul_ps(r, r);
+
+	__m128 s = _mm_set1_ps(-1.9515295891e-4f);
+	s = _mm_add_ps(_mm_mul_ps(s, r2), _mm_set1_ps(8.3321608736e-3f));
+	s = _mm_add_ps(_mm_mul_ps(s, r2), _mm_set1_ps(-1.6666654611e-1f));
+	s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, r2), r), r);
+
+	__m128 c = _mm_set1_ps(2.443315711809948e-5f);
+	c = _mm_add_ps(_mm_mul_ps(c, r2), _mm_set1_ps(-1.388731625493765e-3f));
+	c = _mm_add_ps(_mm_mul_ps(c, r2), _mm_set1_ps(4.166664568298827e-2f));
+	c = _mm_mul_ps(_mm_mul_ps(c, r2), r2);
+	c = _mm_add_ps(_mm_sub_ps(c, _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+	// Quadrants 1 and 3 swap sin and cos, quadrants 2 and 3 negate sin, 1 and 2 negate cos
+	__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+	__m128 sin_value = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+	__m128 cos_value = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+
+	__m128 sin_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+	__m128 cos_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+	*sine = _mm_xor_ps(sin_value, sin_sign);
+	*cosine = _mm_xor_ps(cos_value, cos_sign);
+}
+
+// Affine rows for sprites [i, i + 4)
+static void transform_rows_ps(const float *x, const float *y, const float *width, const float *height, const float *rotation, uint32_t i, __m128 *a, __m128 *b, __m128 *c, __m128 *d, __m128 *tx, __m128 *ty) {
+	__m128 px = _mm_loadu_ps(x + i), py = _mm_loadu_ps(y + i);
+	__m128 w = _mm_loadu_ps(width + i), h = _mm_loadu_ps(height + i);
+	__m128 angle = _mm_loadu_ps(rotation + i);
+
+	if (_mm_movemask_ps(_mm_cmpneq_ps(angle, _mm_setzero_ps())) == 0) {
+		*a = w, *b = _mm_setzero_ps(), *c = _mm_setzero_ps(), *d = h;
+		*tx = px, *ty = py;
+		return;
+	}
+
+	__m128 sine, cosine;
+	sincos_ps(_mm_mul_ps(angle, _mm_set1_ps(DEGREES_TO_RADIANS)), &sine, &cosine);
+
+	const __m128 half = _mm_set1_ps(0.5f);
+	*a = _mm_mul_ps(cosine, w);
+	*b = _mm_mul_ps(sine, w);
+	*c = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(sine, h));
+	*d = _mm_mul_ps(cosine, h);
+	*tx = _mm_add_ps(px, _mm_mul_ps(half, _mm_sub_ps(w, _mm_add_ps(*a, *c))));
+	*ty = _mm_add_ps(py, _mm_mul_ps(half, _mm_sub_ps(h, _mm_add_ps(*b, *d))));
+}
+#endif
+
+void transform_batch_affine(const float *x, const float *y, const float *width, const float *height, const float *rotation, uint32_t count, Affine2D *out) {
+	uint32_t i = 0;
+#ifdef TRANSFORM_SSE2
+	for (; i + 4 <= count; i += 4) {
+		__m128 a, b, c, d, tx, ty;
+		transform_rows_ps(x, y, width, height, rotation, i, &a, &b, &c, &d, &tx, &ty);
+
+		// Transpose SoA rows into { a, c, tx, 0 } { b, d, ty, 0 } per sprite
+		__m128 row0_0 = a, row0_1 = c, row0_2 = tx, row0_3 = _mm_setzero_ps();
+		__m128 row1_0 = b, row1_1 = d, row1_2 = ty, row1_3 = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(row0_0, row0_1, row0_2, row0_3);
+		_MM_TRANSPOSE4_PS(row1_0, row1_1, row1_2, row1_3);
+
+		_mm_storeu_ps(out[i + 0].row[0], row0_0);
+		_mm_storeu_ps(out[i + 0].row[1], row1_0);
+		_mm_storeu_ps(out[i + 1].row[0], row0_1);
+		_mm_storeu_ps(out[i + 1].row[1], row1_1);
+		_mm_storeu_ps(out[i + 2].row[0], row0_2);
+		_mm_storeu_ps(out[i + 2].row[1], row1_2);
+		_mm_storeu_ps(out[i + 3].row[0], row0_3);
+		_mm_storeu_ps(out[i + 3].row[1], row1_3);
+	}
+#endif
+	for (; i < count; i++) {
+		float a, b, c, d, tx, ty;
+		transform_scalar(x[i], y[i], width[i], height[i], rotation[i], &a, &b, &c, &d, &tx, &ty);
+		out[i] = (Affine2D){ { { a, c, tx, 0.0f }, { b, d, ty, 0.0f } } };
+	}
+}
+
+void transform_batch_corners(const float *x, const float *y, const float *width, const float *height, const float *rotation, uint32_t count, float *out) {
+	uint32_t i = 0;
+#ifdef TRANSFORM_SSE2
+	for (; i + 4 <= count; i += 4) {
+		__m128 a, b, c, d, tx, ty;
+		transform_rows_ps(x, y, width, height, rotation, i, &a, &b, &c, &d, &tx, &ty);
+
+		__m128 x0 = tx, y0 = ty;
+		__m128 x1 = _mm_add_ps(tx, a), y1 = _mm_add_ps(ty, b);
+		__m128 x2 = _mm_add_ps(x1, c), y2 = _mm_add_ps(y1, d);
+		__m128 x3 = _mm_add_ps(tx, c), y3 = _mm_add_ps(ty, d);
+
+		// Two 4x4 transposes turn the corner lanes into 8 consecutive floats per sprite
+		_MM_TRANSPOSE4_PS(x0, y0, x1, y1);
+		_MM_TRANSPOSE4_PS(x2, y2, x3, y3);
+
+		float *destination = out + (size_t)i * 8;
+		_mm_storeu_ps(destination + 0, x0);
+		_mm_storeu_ps(destination + 4, x2);
+		_mm_storeu_ps(destination + 8, y0);
+		_mm_storeu_ps(destination + 12, y2);
+		_mm_storeu_ps(destination + 16, x1);
+		_mm_storeu_ps(destination + 20, x3);
+		_mm_storeu_ps(destination + 24, y1);
+		_mm_storeu_ps(destination + 28, y3);
+	}
+#endif
+	for (; i < count; i++) {
+		float a, b, c, d, tx, ty;
+		transform_scalar(x[i], y[i], width[i], height[i], rotation[i], &a, &b, &c, &d, &tx, &ty);
+
+		float *destination = out + (size_t)i * 8;
+		destination[0] = tx, destination[1] = ty;
+		destination[2] = tx + a, destination[3] = ty + b;
+		destination[4] = tx + a + c, destination[5] = ty + b + d;
+		destination[6] = tx + c, destination[7] = ty + d;
+	}
+}
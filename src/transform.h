@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+
+// Maps the unit quad onto a sprite: x' = row[0] . (u, v, 1), y' = row[1] . (u, v, 1).
+// Two vec4 rows so the layout can be copied straight into std430 buffers.
+typedef struct {
+	float row[2][4];
+} Affine2D;
+
+// SoA batch kernels. Each sprite is the position/size rectangle rotated by rotation degrees around
+// its center, the same placement as renderer_draw_sprite. Groups of four sprites that are all
+// unrotated skip the trigonometry entirely.
+void transform_batch_affine(const float *x, const float *y, const float *width, const float *height, const float *rotation, uint32_t count, Affine2D *out);
+
+// Writes 8 floats per sprite: corners (0,0) (1,0) (1,1) (0,1) of the unit quad as x, y pairs
+void transform_batch_corners(const float *x, const float *y, const float *width, const float *height, const float *rotation, uint32_t count, float *out);
@@ -1,3 +1,5 @@
+#pragma once
+
 #include "texture.h"
 
 #include <cglm/cglm.h>
@@ -6,7 +8,7 @@ typedef struct sprite {
 	vec2 position, size;
 	float rotation;
 
-	OpenGLTexture *texture;
+	TextureRegion *texture;
 	vec3 color;
 
 	bool is_solid, is_destroyed;
@@ -0,0 +1,528 @@
+#include "bc_encoder.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define BLOCK_TEXELS 16
+
+static const uint32_t g_bc7_weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+static const uint32_t g_bc7_weights2[4] = { 0, 21, 43, 64 };
+
+static float clamp_byte(float value) {
+	return value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value);
+}
+
+// Endpoints at the extremes of the texels projected on their principal axis, found by power
+// iteration on the covariance. Texels with mask[i] false are ignored.
+static void principal_endpoints(const uint8_t texels[64], uint32_t channels, const bool mask[16], float e0[4], float e1[4]) {
+	float mean[4] = { 0 }, covariance[4][4] = { { 0 } };
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		if (!mask[i])
+			continue;
+		for (uint32_t c = 0; c < channels; c++)
+			mean[c] += texels[4 * i + c];
+		count++;
+	}
+	for (uint32_t c = 0; c < channels; c++)
+		mean[c] /= count ? count : 1;
+
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		if (!mask[i])
+			continue;
+		for (uint32_t a = 0; a < channels; a++)
+			for (uint32_t b = 0; b < channels; b++)
+				covariance[a][b] += (texels[4 * i + a] - mean[a]) * (texels[4 * i + b] - mean[b]);
+	}
+
+	float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	for (uint32_t iteration = 0; iteration < 8; iteration++) {
+		float next[4] = { 0 }, length = 0.0f;
+		for (uint32_t a = 0; a < channels; a++) {
+			for (uint32_t b = 0; b < channels; b++)
+				next[a] += covariance[a][b] * axis[b];
+			length += next[a] * next[a];
+		}
+		if (length < 1e-12f) {
+			memset(axis, 0, sizeof(axis));
+			break;
+		}
+		length = sqrtf(length);
+		for (uint32_t c = 0; c < channels; c++)
+			axis[c] = next[c] / length;
+	}
+
+	float minimum = 0.0f, maximum = 0.0f;
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		if (!mask[i])
+			continue;
+		float t = 0.0f;
+		for (uint32_t c = 0; c < channels; c++)
+			t += (texels[4 * i + c] - mean[c]) * axis[c];
+		minimum = t < minimum ? t : minimum;
+		maximum = t > maximum ? t : maximum;
+	}
+
+	for (uint32_t c = 0; c < 4; c++) {
+		e0[c] = c < channels ? clamp_byte(mean[c] + minimum * axis[c]) : 255.0f;
+		e1[c] = c < channels ? clamp_byte(mean[c] + maximum * axis[c]) : 255.0f;
+	}
+}
+
+// Least squares endpoints for texels interpolated at the given weights between e0 and e1. The
+// color channels of each texel count in proportion to its alpha, alpha itself counts fully.
+static bool refit_endpoints(const uint8_t texels[64], uint32_t channels, const bool mask[16], const float weights[16], float e0[4], float e1[4]) {
+	bool success = true;
+	for (uint32_t channel = 0; channel < channels; channel++) {
+		float a = 0.0f, b = 0.0f, c = 0.0f, x0 = 0.0f, x1 = 0.0f;
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+			if (!mask[i])
+				continue;
+			float importance = channel == 3 ? 1.0f : (texels[4 * i + 3] + 1) / 256.0f;
+			float w = weights[i], v = 1.0f - w;
+			a += importance * v * v;
+			b += importance * v * w;
+			c += importance * w * w;
+			x0 += importance * v * texels[4 * i + channel];
+			x1 += importance * w * texels[4 * i + channel];
+		}
+
+		float determinant = a * c - b * b;
+		if (fabsf(determinant) < 1e-6f) {
+			success = false;
+			continue;
+		}
+		e0[channel] = clamp_byte((c * x0 - b * x1) / determinant);
+		e1[channel] = clamp_byte((a * x1 - b * x0) / determinant);
+	}
+	return success;
+}
+
+static uint16_t pack_565(const float color[4]) {
+	uint32_t r = (uint32_t)(color[0] * 31.0f / 255.0f + 0.5f);
+	uint32_t g = (uint32_t)(color[1] * 63.0f / 255.0f + 0.5f);
+	uint32_t b = (uint32_t)(color[2] * 31.0f / 255.0f + 0.5f);
+	return (uint16_t)(r << 11 | g << 5 | b);
+}
+
+static void unpack_565(uint16_t packed, int32_t color[3]) {
+	uint32_t r = packed >> 11, g = packed >> 5 & 63, b = packed & 31;
+	color[0] = r << 3 | r >> 2;
+	color[1] = g << 2 | g >> 4;
+	color[2] = b << 3 | b >> 2;
+}
+
+// Picks the closest palette entry per texel and returns the total squared error
+static uint32_t bc1_select(const uint8_t texels[64], const bool transparent[16], uint16_t c0, uint16_t c1, bool four_color, uint32_t *indices) {
+	int32_t palette[4][3];
+	unpack_565(c0, palette[0]);
+	unpack_565(c1, palette[1]);
+	for (uint32_t c = 0; c < 3; c++) {
+		if (four_color) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		} else {
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+
+	uint32_t error = 0;
+	*indices = 0;
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		if (transparent[i]) {
+			*indices |= 3u << (2 * i);
+			continue;
+		}
+		if (texels[4 * i + 3] == 0)
+			continue;
+
+		uint32_t best = 0, best_error = UINT32_MAX;
+		for (uint32_t entry = 0; entry < (four_color ? 4u : 3u); entry++) {
+			uint32_t entry_error = 0;
+			for (uint32_t c = 0; c < 3; c++) {
+				int32_t difference = palette[entry][c] - texels[4 * i + c];
+				entry_error += difference * difference;
+			}
+			if (entry_error < best_error) {
+				best = entry;
+				best_error = entry_error;
+			}
+		}
+		*indices |= best << (2 * i);
+		error += best_error;
+	}
+	return error;
+}
+
+// Four color mode needs c0 > c1, three color mode with transparency needs c0 <= c1
+static uint32_t bc1_try(const uint8_t texels[64], const bool transparent[16], const float e0[4], const float e1[4], bool four_color, uint16_t *c0, uint16_t *c1, uint32_t *indices) {
+	*c0 = pack_565(e1);
+	*c1 = pack_565(e0);
+	if ((four_color && *c0 < *c1) || (!four_color && *c0 > *c1)) {
+		uint16_t swap = *c0;
+		*c0 = *c1;
+		*c1 = swap;
+	}
+	return bc1_select(texels, transparent, *c0, *c1, four_color, indices);
+}
+
+static void bc1_encode_color(const uint8_t texels[64], bool allow_transparent, uint8_t block[8]) {
+	bool transparent[16], opaque[16];
+	bool any_transparent = false, any_opaque = false;
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		transparent[i] = allow_transparent && texels[4 * i + 3] < 128;
+		// Invisible texels take any color
+		opaque[i] = !transparent[i] && texels[4 * i + 3] > 0;
+		any_transparent |= transparent[i];
+		any_opaque |= opaque[i];
+	}
+
+	uint16_t c0 = 0, c1 = 0;
+	uint32_t indices = UINT32_MAX;
+	if (any_opaque) {
+		bool four_color = !any_transparent;
+		float e0[4], e1[4];
+		principal_endpoints(texels, 3, opaque, e0, e1);
+		uint32_t error = bc1_try(texels, transparent, e0, e1, four_color, &c0, &c1, &indices);
+
+		// Refit once against the chosen indices, palette entries 0 and 1 are the endpoints
+		static const float four_color_weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		static const float three_color_weights[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+		float weights[16];
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+			weights[i] = (four_color ? four_color_weights : three_color_weights)[indices >> (2 * i) & 3];
+
+		float r0[4], r1[4];
+		int32_t p0[3], p1[3];
+		unpack_565(c0, p0);
+		unpack_565(c1, p1);
+		for (uint32_t c = 0; c < 3; c++) {
+			r0[c] = (float)p0[c];
+			r1[c] = (float)p1[c];
+		}
+		if (refit_endpoints(texels, 3, opaque, weights, r0, r1)) {
+			uint16_t refit_c0, refit_c1;
+			uint32_t refit_indices;
+			// bc1_try puts its second endpoint first
+			uint32_t refit_error = bc1_try(texels, transparent, r1, r0, four_color, &refit_c0, &refit_c1, &refit_indices);
+			if (refit_error < error) {
+				c0 = refit_c0;
+				c1 = refit_c1;
+				indices = refit_indices;
+			}
+		}
+	}
+
+	block[0] = (uint8_t)c0;
+	block[1] = (uint8_t)(c0 >> 8);
+	block[2] = (uint8_t)c1;
+	block[3] = (uint8_t)(c1 >> 8);
+	for (uint32_t i = 0; i < 4; i++)
+		block[4 + i] = (uint8_t)(indices >> (8 * i));
+}
+
+void bc1_encode_block(const uint8_t texels[64], uint8_t block[8]) {
+	bc1_encode_color(texels, true, block);
+}
+
+// BC4 style alpha block, eight values interpolated between the extremes
+static void bc3_encode_alpha(const uint8_t texels[64], uint8_t block[8]) {
+	uint32_t minimum = 255, maximum = 0;
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		uint32_t alpha = texels[4 * i + 3];
+		minimum = alpha < minimum ? alpha : minimum;
+		maximum = alpha > maximum ? alpha : maximum;
+	}
+
+	memset(block, 0, 8);
+	block[0] = (uint8_t)maximum;
+	block[1] = (uint8_t)minimum;
+	if (maximum == minimum)
+		return;
+
+	uint32_t palette[8] = { maximum, minimum };
+	for (uint32_t i = 1; i < 7; i++)
+		palette[i + 1] = ((7 - i) * maximum + i * minimum) / 7;
+
+	uint64_t indices = 0;
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		uint32_t alpha = texels[4 * i + 3];
+		uint64_t best = 0;
+		uint32_t best_error = UINT32_MAX;
+		for (uint32_t entry = 0; entry < 8; entry++) {
+			uint32_t error = alpha > palette[entry] ? alpha - palette[entry] : palette[entry] - alpha;
+			if (error < best_error) {
+				best = entry;
+				best_error = error;
+			}
+		}
+		indices |= best << (3 * i);
+	}
+	for (uint32_t i = 0; i < 6; i++)
+		block[2 + i] = (uint8_t)(indices >> (8 * i));
+}
+
+void bc3_encode_block(const uint8_t texels[64], uint8_t block[16]) {
+	bc3_encode_alpha(texels, block);
+	bc1_encode_color(texels, false, block + 8);
+}
+
+// Mode 6 endpoints are 7 bits per channel plus a shared low bit, pick the one closer to e
+static void bc7_quantize(const float e[4], uint32_t quantized[4], uint32_t *p_bit, uint32_t expanded[4]) {
+	float best_error = INFINITY;
+	for (uint32_t p = 0; p < 2; p++) {
+		uint32_t candidate[4];
+		float error = 0.0f;
+		for (uint32_t c = 0; c < 4; c++) {
+			float value = (e[c] - p) / 2.0f;
+			candidate[c] = value <= 0.0f ? 0 : (value >= 127.0f ? 127 : (uint32_t)(value + 0.5f));
+			float difference = (float)(candidate[c] << 1 | p) - e[c];
+			error += difference * difference;
+		}
+		if (error < best_error) {
+			best_error = error;
+			*p_bit = p;
+			for (uint32_t c = 0; c < 4; c++) {
+				quantized[c] = candidate[c];
+				expanded[c] = candidate[c] << 1 | p;
+			}
+		}
+	}
+}
+
+static uint32_t bc7_select(const uint8_t texels[64], const uint32_t e0[4], const uint32_t e1[4], uint32_t indices[16]) {
+	uint32_t palette[16][4];
+	for (uint32_t entry = 0; entry < 16; entry++)
+		for (uint32_t c = 0; c < 4; c++)
+			palette[entry][c] = ((64 - g_bc7_weights[entry]) * e0[c] + g_bc7_weights[entry] * e1[c] + 32) >> 6;
+
+	uint32_t error = 0;
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		uint32_t best_error = UINT32_MAX;
+		for (uint32_t entry = 0; entry < 16; entry++) {
+			uint32_t color_error = 0;
+			for (uint32_t c = 0; c < 3; c++) {
+				int32_t difference = (int32_t)palette[entry][c] - texels[4 * i + c];
+				color_error += difference * difference;
+			}
+			int32_t alpha_difference = (int32_t)palette[entry][3] - texels[4 * i + 3];
+			uint32_t entry_error = color_error * (texels[4 * i + 3] + 1) / 256 + alpha_difference * alpha_difference;
+			if (entry_error < best_error) {
+				indices[i] = entry;
+				best_error = entry_error;
+			}
+		}
+		error += best_error;
+	}
+	return error;
+}
+
+static void bit_write(uint8_t *block, uint32_t *position, uint32_t value, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++, (*position)++) {
+		if (value >> i & 1)
+			block[*position / 8] |= (uint8_t)(1 << (*position % 8));
+	}
+}
+
+// Invisible texels take the average visible color, so only their alpha shapes the endpoints
+static void bc7_fill_invisible(const uint8_t texels[64], uint8_t fitted[64]) {
+	uint32_t sum[3] = { 0 }, visible_count = 0;
+	memcpy(fitted, texels, 64);
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		if (texels[4 * i + 3] == 0)
+			continue;
+		for (uint32_t c = 0; c < 3; c++)
+			sum[c] += texels[4 * i + c];
+		visible_count++;
+	}
+	for (uint32_t i = 0; i < BLOCK_TEXELS && visible_count; i++) {
+		if (texels[4 * i + 3] == 0) {
+			for (uint32_t c = 0; c < 3; c++)
+				fitted[4 * i + c] = (uint8_t)(sum[c] / visible_count);
+		}
+	}
+}
+
+// One RGBA line with 4 bit indices
+static uint32_t bc7_encode_mode6(const uint8_t texels[64], const uint8_t fitted[64], uint8_t block[16]) {
+	bool all[16];
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		all[i] = true;
+
+	float e0[4], e1[4];
+	principal_endpoints(fitted, 4, all, e0, e1);
+
+	uint32_t quantized[2][4], p_bits[2], expanded[2][4], indices[16];
+	bc7_quantize(e0, quantized[0], &p_bits[0], expanded[0]);
+	bc7_quantize(e1, quantized[1], &p_bits[1], expanded[1]);
+	uint32_t error = bc7_select(texels, expanded[0], expanded[1], indices);
+
+	for (uint32_t iteration = 0; iteration < 2 && error > 0; iteration++) {
+		float weights[16];
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+			weights[i] = g_bc7_weights[indices[i]] / 64.0f;
+		for (uint32_t c = 0; c < 4; c++) {
+			e0[c] = (float)expanded[0][c];
+			e1[c] = (float)expanded[1][c];
+		}
+		if (!refit_endpoints(texels, 4, all, weights, e0, e1))
+			break;
+
+		uint32_t refit_quantized[2][4], refit_p_bits[2], refit_expanded[2][4], refit_indices[16];
+		bc7_quantize(e0, refit_quantized[0], &refit_p_bits[0], refit_expanded[0]);
+		bc7_quantize(e1, refit_quantized[1], &refit_p_bits[1], refit_expanded[1]);
+		uint32_t refit_error = bc7_select(texels, refit_expanded[0], refit_expanded[1], refit_indices);
+		if (refit_error >= error)
+			break;
+
+		error = refit_error;
+		memcpy(quantized, refit_quantized, sizeof(quantized));
+		memcpy(p_bits, refit_p_bits, sizeof(p_bits));
+		memcpy(expanded, refit_expanded, sizeof(expanded));
+		memcpy(indices, refit_indices, sizeof(indices));
+	}
+
+	// The first index is stored without its high bit, so it must be below 8
+	uint32_t first = 0, second = 1;
+	if (indices[0] >= 8) {
+		first = 1;
+		second = 0;
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+			indices[i] = 15 - indices[i];
+	}
+
+	memset(block, 0, 16);
+	uint32_t position = 0;
+	bit_write(block, &position, 1 << 6, 7);
+	for (uint32_t c = 0; c < 4; c++) {
+		bit_write(block, &position, quantized[first][c], 7);
+		bit_write(block, &position, quantized[second][c], 7);
+	}
+	bit_write(block, &position, p_bits[first], 1);
+	bit_write(block, &position, p_bits[second], 1);
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		bit_write(block, &position, indices[i], i == 0 ? 3 : 4);
+
+	return error;
+}
+
+static void bc7_quantize_color(const float e[4], uint32_t quantized[3], uint32_t expanded[3]) {
+	for (uint32_t c = 0; c < 3; c++) {
+		quantized[c] = (uint32_t)(e[c] * 127.0f / 255.0f + 0.5f);
+		expanded[c] = quantized[c] << 1 | quantized[c] >> 6;
+	}
+}
+
+static uint32_t bc7_select_color(const uint8_t texels[64], const uint32_t e0[3], const uint32_t e1[3], uint32_t indices[16]) {
+	uint32_t error = 0;
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		uint32_t best_error = UINT32_MAX;
+		for (uint32_t entry = 0; entry < 4; entry++) {
+			uint32_t entry_error = 0;
+			for (uint32_t c = 0; c < 3; c++) {
+				int32_t value = ((64 - g_bc7_weights2[entry]) * e0[c] + g_bc7_weights2[entry] * e1[c] + 32) >> 6;
+				entry_error += (value - texels[4 * i + c]) * (value - texels[4 * i + c]);
+			}
+			if (entry_error < best_error) {
+				indices[i] = entry;
+				best_error = entry_error;
+			}
+		}
+		error += best_error * (texels[4 * i + 3] + 1) / 256;
+	}
+	return error;
+}
+
+// An RGB line and a separate alpha line with 2 bit indices each, for hard alpha edges across
+// colors that do not lie on one line with transparency
+static uint32_t bc7_encode_mode5(const uint8_t texels[64], const uint8_t fitted[64], uint8_t block[16]) {
+	bool all[16];
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		all[i] = true;
+
+	float e0[4], e1[4];
+	principal_endpoints(fitted, 3, all, e0, e1);
+
+	uint32_t quantized[2][3], expanded[2][3], color_indices[16];
+	bc7_quantize_color(e0, quantized[0], expanded[0]);
+	bc7_quantize_color(e1, quantized[1], expanded[1]);
+	uint32_t color_error = bc7_select_color(texels, expanded[0], expanded[1], color_indices);
+
+	float weights[16];
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		weights[i] = g_bc7_weights2[color_indices[i]] / 64.0f;
+	for (uint32_t c = 0; c < 3; c++) {
+		e0[c] = (float)expanded[0][c];
+		e1[c] = (float)expanded[1][c];
+	}
+	if (color_error > 0 && refit_endpoints(texels, 3, all, weights, e0, e1)) {
+		uint32_t refit_quantized[2][3], refit_expanded[2][3], refit_indices[16];
+		bc7_quantize_color(e0, refit_quantized[0], refit_expanded[0]);
+		bc7_quantize_color(e1, refit_quantized[1], refit_expanded[1]);
+		uint32_t refit_error = bc7_select_color(texels, refit_expanded[0], refit_expanded[1], refit_indices);
+		if (refit_error < color_error) {
+			color_error = refit_error;
+			memcpy(quantized, refit_quantized, sizeof(quantized));
+			memcpy(color_indices, refit_indices, sizeof(color_indices));
+		}
+	}
+
+	uint32_t alpha[2] = { 255, 0 }, alpha_indices[16], alpha_error = 0;
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		alpha[0] = texels[4 * i + 3] < alpha[0] ? texels[4 * i + 3] : alpha[0];
+		alpha[1] = texels[4 * i + 3] > alpha[1] ? texels[4 * i + 3] : alpha[1];
+	}
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+		uint32_t best_error = UINT32_MAX;
+		for (uint32_t entry = 0; entry < 4; entry++) {
+			int32_t value = ((64 - g_bc7_weights2[entry]) * alpha[0] + g_bc7_weights2[entry] * alpha[1] + 32) >> 6;
+			uint32_t entry_error = (value - texels[4 * i + 3]) * (value - texels[4 * i + 3]);
+			if (entry_error < best_error) {
+				alpha_indices[i] = entry;
+				best_error = entry_error;
+			}
+		}
+		alpha_error += best_error;
+	}
+
+	// Both first indices are stored without their high bit
+	uint32_t color_first = 0, alpha_first = 0;
+	if (color_indices[0] >= 2) {
+		color_first = 1;
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+			color_indices[i] = 3 - color_indices[i];
+	}
+	if (alpha_indices[0] >= 2) {
+		alpha_first = 1;
+		for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+			alpha_indices[i] = 3 - alpha_indices[i];
+	}
+
+	memset(block, 0, 16);
+	uint32_t position = 0;
+	bit_write(block, &position, 1 << 5, 6);
+	bit_write(block, &position, 0, 2);
+	for (uint32_t c = 0; c < 3; c++) {
+		bit_write(block, &position, quantized[color_first][c], 7);
+		bit_write(block, &position, quantized[1 - color_first][c], 7);
+	}
+	bit_write(block, &position, alpha[alpha_first], 8);
+	bit_write(block, &position, alpha[1 - alpha_first], 8);
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		bit_write(block, &position, color_indices[i], i == 0 ? 1 : 2);
+	for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+		bit_write(block, &position, alpha_indices[i], i == 0 ? 1 : 2);
+
+	return color_error + alpha_error;
+}
+
+void bc7_encode_block(const uint8_t texels[64], uint8_t block[16]) {
+	uint8_t fitted[64], mode5[16];
+	bc7_fill_invisible(texels, fitted);
+
+	uint32_t error = bc7_encode_mode6(texels, fitted, block);
+	if (error > 0 && bc7_encode_mode5(texels, fitted, mode5) < error)
+		memcpy(block, mode5, 16);
+}
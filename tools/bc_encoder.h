@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdint.h>
+
+// Block encoders for the texture cooker. Each takes a 4x4 block of RGBA8 texels in row order
+// and writes one compressed block: 8 bytes for BC1, 16 for BC3 and BC7.
+
+// Texels with alpha below 128 become the transparent BC1 index, the rest are opaque
+void bc1_encode_block(const uint8_t texels[64], uint8_t block[8]);
+// BC1 color with a separately interpolated alpha channel
+void bc3_encode_block(const uint8_t texels[64], uint8_t block[16]);
+// Modes 5 and 6 only, whichever fits the block better. Neither partitions the block, so blocks
+// with several unrelated colors lose more detail than a full encoder would.
+void bc7_encode_block(const uint8_t texels[64], uint8_t block[16]);
@@ -0,0 +1,243 @@
+// Cooks assets into the archive the game maps at startup. Levels (.csv) become their tile grid,
+// images (.png) their decoded texels, and shader stages (.glsl with a #version) a single source with
+// every #include resolved. Files without a #version are includes and only end up inside the stages
+// using them. Anything else, like .ktx2 textures from texture_cooker, is stored as is.
+// Each entry keeps a hash of its source. Unchanged sources reuse the blob already in the previous
+// archive, and the archive is not rewritten when nothing changed. Entries are named by the path
+// given on the command line, so run it from the directory the game runs in.
+// usage: breakout_cook [--force] --output FILE asset...
+
+#include "core/logger.h"
+#include "level_file.h"
+#include "pak.h"
+#include "shader_preprocessor.h"
+
+#include <stb/stb_image.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Bump when a cooked form changes, every asset is recooked then
+#define COOK_VERSION 1
+
+typedef enum {
+	COOK_FILE,
+	COOK_IMAGE,
+	COOK_LEVEL,
+	COOK_SHADER,
+} CookKind;
+
+typedef struct {
+	PakSource source;
+	// Buffer behind source.data, NULL when it points into the previous archive
+	void *owned;
+	bool skipped, reused;
+} CookedAsset;
+
+static bool path_has_extension(const char *path, const char *extension) {
+	size_t length = strlen(path), extension_length = strlen(extension);
+	return length > extension_length && strcmp(path + length - extension_length, extension) == 0;
+}
+
+static CookKind cook_kind(const char *path) {
+	if (path_has_extension(path, ".png"))
+		return COOK_IMAGE;
+	if (path_has_extension(path, ".csv"))
+		return COOK_LEVEL;
+	if (path_has_extension(path, ".glsl"))
+		return COOK_SHADER;
+	return COOK_FILE;
+}
+
+static PakEntryType cook_entry_type(CookKind kind) {
+	switch (kind) {
+		case COOK_IMAGE: return PAK_ENTRY_IMAGE;
+		case COOK_LEVEL: return PAK_ENTRY_LEVEL;
+		default: return PAK_ENTRY_FILE;
+	}
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t size) {
+	const uint8_t *bytes = data;
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	return hash;
+}
+
+// Null terminated, so levels can be parsed in place
+static char *read_file(const char *path, size_t *size) {
+	FILE *file = fopen(path, "rb");
+	if (file == NULL)
+		return NULL;
+
+	fseek(file, 0, SEEK_END);
+	long file_size = ftell(file);
+	rewind(file);
+
+	char *data = file_size >= 0 ? malloc(file_size + 1) : NULL;
+	*size = data ? fread(data, 1, file_size, file) : 0;
+	fclose(file);
+	if (data && *size != (size_t)file_size) {
+		free(data);
+		return NULL;
+	}
+	if (data)
+		data[*size] = '\0';
+	return data;
+}
+
+// The stage with every include resolved, which is what the hash covers as well
+static char *cook_shader(const char *path, size_t *size, bool *is_stage) {
+	PreprocessedShader shader;
+	if (!shader_preprocess(path, &shader)) {
+		LOG_ERROR("COOK: %s failed to preprocess", path);
+		return NULL;
+	}
+
+	*is_stage = shader.prologue_length > 0;
+	*size = strlen(shader.source);
+	return shader.source;
+}
+
+static bool cook_asset(const char *path, const Pak *previous, CookedAsset *asset) {
+	*asset = (CookedAsset){ 0 };
+	PakSource *source = &asset->source;
+	if (!pak_normalize_name(path, source->name)) {
+		LOG_ERROR("COOK: %s is longer than %d characters", path, PAK_NAME_LENGTH - 1);
+		return false;
+	}
+
+	CookKind kind = cook_kind(path);
+	source->type = cook_entry_type(kind);
+
+	size_t size = 0;
+	bool is_stage = true;
+	char *content = kind == COOK_SHADER ? cook_shader(path, &size, &is_stage) : read_file(path, &size);
+	if (content == NULL) {
+		if (kind != COOK_SHADER)
+			LOG_ERROR("COOK: Failed to read %s", path);
+		return false;
+	}
+	if (!is_stage) {
+		LOG_INFO("COOK: %s has no #version, cooked into the stages including it", path);
+		free(content);
+		asset->skipped = true;
+		return true;
+	}
+
+	uint32_t version = COOK_VERSION;
+	source->hash = hash_bytes(hash_bytes(14695981039346656037ull, &version, sizeof(version)), content, size);
+
+	const PakEntry *entry = previous->entry_count ? pak_find(previous, source->name) : NULL;
+	if (entry && entry->hash == source->hash && entry->type == source->type) {
+		source->width = entry->width;
+		source->height = entry->height;
+		source->channels = entry->channels;
+		source->data = pak_entry_data(previous, entry);
+		source->size = entry->size;
+		asset->reused = true;
+		free(content);
+		return true;
+	}
+
+	if (kind == COOK_IMAGE) {
+		int32_t width, height, channels;
+		asset->owned = stbi_load_from_memory((const uint8_t *)content, (int32_t)size, &width, &height, &channels, 0);
+		free(content);
+		if (asset->owned == NULL) {
+			LOG_ERROR("COOK: Failed to decode %s: %s", path, stbi_failure_reason());
+			return false;
+		}
+		source->width = width;
+		source->height = height;
+		source->channels = channels;
+		source->size = (size_t)width * height * channels;
+	} else if (kind == COOK_LEVEL) {
+		LevelTiles level;
+		bool success = level_file_parse_csv(path, content, size, &level);
+		free(content);
+		if (!success)
+			return false;
+		asset->owned = level.owned;
+		source->width = level.columns;
+		source->height = level.rows;
+		source->size = (size_t)level.columns * level.rows;
+	} else {
+		asset->owned = content;
+		source->size = size;
+	}
+
+	source->data = asset->owned;
+	return true;
+}
+
+int main(int argc, char **argv) {
+	const char *output = NULL;
+	bool force = false;
+	int32_t first_input = argc;
+	for (int32_t i = 1; i < argc && first_input == argc; i++) {
+		if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+			output = argv[++i];
+		else if (strcmp(argv[i], "--force") == 0)
+			force = true;
+		else
+			first_input = i;
+	}
+
+	if (output == NULL || first_input == argc) {
+		fprintf(stderr, "usage: %s [--force] --output FILE asset...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// Blobs of unchanged assets are copied straight out of the previous archive
+	Pak previous = { 0 };
+	if (!force)
+		pak_open(output, &previous);
+
+	uint32_t count = (uint32_t)(argc - first_input);
+	CookedAsset *assets = calloc(count, sizeof(CookedAsset));
+	PakSource *sources = calloc(count, sizeof(PakSource));
+	bool success = assets != NULL && sources != NULL;
+
+	uint32_t source_count = 0, cooked_count = 0;
+	size_t total_size = 0;
+	for (uint32_t i = 0; i < count && success; i++) {
+		success = cook_asset(argv[first_input + i], &previous, &assets[i]);
+		if (!success || assets[i].skipped)
+			continue;
+
+		sources[source_count++] = assets[i].source;
+		cooked_count += !assets[i].reused;
+		total_size += assets[i].source.size;
+	}
+
+	bool up_to_date = success && !force && cooked_count == 0 && previous.entry_count == source_count;
+	if (up_to_date) {
+		LOG_INFO("COOK: %s is up to date, %u assets", output, source_count);
+	} else if (success) {
+		char temporary[512];
+		snprintf(temporary, sizeof(temporary), "%s.tmp", output);
+		success = pak_write(temporary, sources, source_count);
+
+		// The previous archive can only be replaced once nothing points into it
+		pak_close(&previous);
+		if (success) {
+			remove(output);
+			if (rename(temporary, output) != 0) {
+				LOG_ERROR("COOK: Cannot replace %s", output);
+				success = false;
+			}
+		}
+		if (success)
+			LOG_INFO("COOK: %u assets -> %s, %u cooked, %u unchanged, %zu bytes of data", source_count, output, cooked_count, source_count - cooked_count, total_size);
+	}
+
+	for (uint32_t i = 0; assets && i < count; i++)
+		free(assets[i].owned);
+	free(assets);
+	free(sources);
+	pak_close(&previous);
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,170 @@
+// Encodes images into block compressed KTX2 textures with a full mip chain.
+// usage: texture_cooker [--format bc1|bc3|bc7] [--filter box|kaiser] [--srgb] [--linear] [--no-mips] [--output DIRECTORY] image...
+
+#include "bc_encoder.h"
+#include "core/logger.h"
+#include "ktx2.h"
+#include "mipmap.h"
+
+#include <stb/stb_image.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+	Ktx2Format format;
+	MipmapFilter filter;
+	// srgb tags the output as sRGB, which the game samples as gamma space like any other texture.
+	// linear downsamples the color as if it were not sRGB.
+	bool srgb, linear, mips;
+	const char *output_directory;
+} CookOptions;
+
+typedef void (*BlockEncoder)(const uint8_t texels[64], uint8_t *block);
+
+static uint8_t *encode_level(const uint8_t *pixels, uint32_t width, uint32_t height, Ktx2Format format, size_t *size) {
+	BlockEncoder encode = bc7_encode_block;
+	uint32_t block_size = 16;
+	if (format == KTX2_FORMAT_BC1) {
+		encode = bc1_encode_block;
+		block_size = 8;
+	} else if (format == KTX2_FORMAT_BC3) {
+		encode = bc3_encode_block;
+	}
+
+	*size = ktx2_level_size(format, width, height);
+	uint8_t *blocks = malloc(*size);
+	if (blocks == NULL)
+		return NULL;
+
+	uint8_t *block = blocks;
+	for (uint32_t block_y = 0; block_y < height; block_y += 4) {
+		for (uint32_t block_x = 0; block_x < width; block_x += 4, block += block_size) {
+			// Partial blocks at the edges repeat the last texel
+			uint8_t texels[64];
+			for (uint32_t y = 0; y < 4; y++) {
+				uint32_t source_y = block_y + y < height ? block_y + y : height - 1;
+				for (uint32_t x = 0; x < 4; x++) {
+					uint32_t source_x = block_x + x < width ? block_x + x : width - 1;
+					memcpy(texels + 4 * (4 * y + x), pixels + ((size_t)source_y * width + source_x) * 4, 4);
+				}
+			}
+			encode(texels, block);
+		}
+	}
+	return blocks;
+}
+
+static bool cook_texture(const char *path, const CookOptions *options) {
+	int32_t width, height, channels;
+	uint8_t *pixels = stbi_load(path, &width, &height, &channels, 4);
+	if (pixels == NULL) {
+		LOG_ERROR("COOKER: Failed to load %s: %s", path, stbi_failure_reason());
+		return false;
+	}
+
+	Ktx2Image image = {
+		.format = options->format,
+		.srgb = options->srgb,
+		.width = width,
+		.height = height,
+	};
+
+	MipChain chain;
+	bool success = mipmap_generate(pixels, width, height, 4, !options->linear, options->mips ? options->filter : MIPMAP_FILTER_NONE, &chain);
+	stbi_image_free(pixels);
+	if (!success) {
+		LOG_ERROR("COOKER: Failed to build the mip chain of %s", path);
+		return false;
+	}
+
+	for (uint32_t level = 0; success && level < chain.level_count && level < KTX2_MAX_LEVELS; level++) {
+		size_t size;
+		uint32_t level_width = mipmap_level_dimension(width, level), level_height = mipmap_level_dimension(height, level);
+		uint8_t *blocks = encode_level(chain.pixels + chain.offsets[level], level_width, level_height, options->format, &size);
+		if (blocks)
+			image.levels[image.level_count++] = (Ktx2Level){ blocks, size };
+		success = blocks != NULL;
+	}
+	mipmap_release(&chain);
+
+	char output[512];
+	const char *name = strrchr(path, '/');
+	name = name ? name + 1 : path;
+	const char *extension = strrchr(name, '.');
+	int32_t stem_length = extension ? (int32_t)(extension - name) : (int32_t)strlen(name);
+	if (options->output_directory)
+		snprintf(output, sizeof(output), "%s/%.*s.ktx2", options->output_directory, stem_length, name);
+	else
+		snprintf(output, sizeof(output), "%.*s.ktx2", (int32_t)(name - path) + stem_length, path);
+
+	size_t total_size = 0;
+	for (uint32_t level = 0; level < image.level_count; level++)
+		total_size += image.levels[level].size;
+
+	success = success && ktx2_write(output, &image);
+	if (success)
+		LOG_INFO("COOKER: %s -> %s, %dx%d %s, %u levels, %zu bytes", path, output, width, height, ktx2_format_name(image.format), image.level_count, total_size);
+
+	for (uint32_t level = 0; level < image.level_count; level++)
+		free((void *)image.levels[level].data);
+	return success;
+}
+
+int main(int argc, char **argv) {
+	CookOptions options = {
+		.format = KTX2_FORMAT_BC7,
+		.filter = MIPMAP_FILTER_KAISER,
+		.mips = true,
+	};
+
+	int32_t first_input = argc;
+	for (int32_t i = 1; i < argc && first_input == argc; i++) {
+		if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "bc1") == 0) {
+				options.format = KTX2_FORMAT_BC1;
+			} else if (strcmp(argv[i], "bc3") == 0) {
+				options.format = KTX2_FORMAT_BC3;
+			} else if (strcmp(argv[i], "bc7") == 0) {
+				options.format = KTX2_FORMAT_BC7;
+			} else {
+				LOG_ERROR("COOKER: Unknown format %s, expected bc1, bc3 or bc7", argv[i]);
+				return EXIT_FAILURE;
+			}
+		} else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "box") == 0) {
+				options.filter = MIPMAP_FILTER_BOX;
+			} else if (strcmp(argv[i], "kaiser") == 0) {
+				options.filter = MIPMAP_FILTER_KAISER;
+			} else {
+				LOG_ERROR("COOKER: Unknown filter %s, expected box or kaiser", argv[i]);
+				return EXIT_FAILURE;
+			}
+		} else if (strcmp(argv[i], "--srgb") == 0) {
+			options.srgb = true;
+		} else if (strcmp(argv[i], "--linear") == 0) {
+			options.linear = true;
+		} else if (strcmp(argv[i], "--no-mips") == 0) {
+			options.mips = false;
+		} else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+			options.output_directory = argv[++i];
+		} else {
+			first_input = i;
+		}
+	}
+
+	if (first_input == argc) {
+		fprintf(stderr, "usage: %s [--format bc1|bc3|bc7] [--filter box|kaiser] [--srgb] [--linear] [--no-mips] [--output DIRECTORY] image...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	uint32_t failure_count = 0;
+	for (int32_t i = first_input; i < argc; i++)
+		failure_count += !cook_texture(argv[i], &options);
+
+	return failure_count ? EXIT_FAILURE : EXIT_SUCCESS;
+}